@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.hpp"
+
+// NOTE: all emulated memory (RAM, VRAM, scratchpad and device register blocks)
+// is allocated at once in a single 2MB aligned mapping, at fixed offsets, see
+// arena.cpp. The mapping is backed by a memfd so FastMem can map views of the
+// same memory. Being shmem, it only gets transparent huge pages when
+// /sys/kernel/mm/transparent_hugepage/shmem_enabled is advise (or always),
+// most distributions default to never and then it uses 4KB pages. CPU,
+// clock and device state other than register blocks live outside of it.
+// Pages are only committed when first touched.
+struct Arena {
+  static constexpr u32 alignment = 0x200000; // 2MB, huge page size
+
+  u8 *data = nullptr;
+  u32 size = 0;
+
+  /// -1 if memfd is not available, then the mapping is anonymous
+  int fd = -1;
+
+  u8 *ram = nullptr;
+  u8 *vram = nullptr;
+  u8 *scratchpad = nullptr;
+  u8 *spu = nullptr;
+  u8 *dma = nullptr;
+
+  Arena() = default;
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  int init();
+  void release();
+
+  /// Reserves size bytes of inaccessible address space aligned to
+  /// alignment, nothing is committed until mapped over, nullptr on failure
+  static u8 *reserve(u32 size);
+
+  constexpr u32 offset(const u8 *at) const { return at - data; }
+
+  /// Bytes of the arena actually committed in host memory, this is the
+  /// per-instance memory cost
+  u64 resident() const;
+};
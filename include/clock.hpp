@@ -3,29 +3,131 @@
 #include "types.hpp"
 #include "peripheral.hpp"
 
+#include <numeric>
+
+/// Clock rates in Hz
+struct ClockRate {
+  // NOTE: the CPU clock is 768 times the CD audio sample rate
+  static constexpr u64 cpu = 33868800;
+  static constexpr u64 gpu_ntsc = 53693175;
+  static constexpr u64 gpu_pal = 53203425;
+  static constexpr u64 spu = cpu / 768; // 44.1kHz
+  static constexpr u64 cdrom_sector = 75; // single speed, double is 150
+};
+
+/// Converts CPU cycles into ticks of another clock domain. The ratio is an
+/// exact reduced fraction and the remainder of each conversion is carried
+/// to the next one, so domains never drift apart however long it runs.
+struct ClockDomain {
+  /// Domain ticks per den CPU cycles
+  u64 num = 1;
+  u64 den = 1;
+
+  /// Fraction of a domain tick already elapsed, in units of 1/den
+  u64 rem = 0;
+
+  /// Domain running at hz / div, div being a divider like the line length
+  static constexpr ClockDomain from_hz(u64 hz, u64 div = 1) {
+    u64 den = ClockRate::cpu * div;
+    u64 gcd = std::gcd(hz, den);
+    return {hz / gcd, den / gcd, 0};
+  }
+
+  /// Advances by cpu_cycles and returns the number of elapsed domain ticks
+  constexpr u64 advance(u64 cpu_cycles) {
+    u64 ticks = cpu_cycles * num + rem;
+    rem = ticks % den;
+    return ticks / den;
+  }
+
+  /// CPU cycles until ticks more domain ticks have elapsed, rounded up
+  constexpr u64 cpu_cycles_until(u64 ticks) const {
+    u64 needed = ticks * den;
+    if (needed <= rem)
+      return 0;
+    return (needed - rem + num - 1) / num;
+  }
+};
+
+struct Clock;
+
+/// Catches a device up by cycles CPU cycles and returns how many CPU cycles
+/// from now it next needs to run, Clock::never if it doesn't
+using SyncHandler = u64 (*)(void *ctx, u64 cycles, Clock &clock);
+
+// NOTE: timed devices are never run per instruction. Each one is caught up
+// in a single batch, by Clock::sync, only when the CPU touches its registers
+// or when the deadline it declared is reached. The clock keeps the last sync
+// time of each device and at most one pending event per device, sorted by
+// deadline. The earliest one is cached in next_deadline so the CPU loop only
+// compares two u64 per instruction no matter how many devices there are.
 struct Clock {
+  static constexpr u64 never = ~u64{0};
+
   struct State {
     u64 prev = 0;
-    // NOTE: next is initially 0, forces sync
-    u64 next = 0;
 
     constexpr u64 sync(u64 time) {
       u64 delta = time - prev;
       prev = time;
       return delta;
     }
+  };
+
+  struct Event {
+    u64 deadline;
+    PCIType who;
+  };
 
-    constexpr void set_alarm(u64 when) { next = when; }
-    constexpr bool should_alarm(u64 time) { return next <= time; }
+  struct Handler {
+    SyncHandler fn = nullptr;
+    void *ctx = nullptr;
   };
 
   u64 now = 0;
+
+  /// Deadline of events[0], never when nothing is scheduled, 0 on break
+  u64 next_deadline = never;
+  bool break_requested = false;
+
   State states[PCIType::SIZE];
+  Handler handlers[PCIType::SIZE];
+
+  /// Pending events sorted by deadline, ties in scheduling order
+  Event events[PCIType::SIZE];
+  u32 event_count = 0;
 
-  constexpr u64 sync(PCIType who) { return states[who].sync(now); }
-  constexpr void set_alarm_after(PCIType who, u64 delta) {
-    states[who].set_alarm(now + delta);
-  }
-  constexpr bool alarmed(PCIType who) { return states[who].should_alarm(now); }
   constexpr void tick(u64 delta) { now += delta; }
+  constexpr bool due() const { return next_deadline <= now; }
+
+  /// Makes the CPU loop stop at the next instruction even if no event is due
+  void request_break() {
+    break_requested = true;
+    next_deadline = 0;
+  }
+
+  /// Device needs a `u64 sync(u64 cycles, Clock &clock)` member, see
+  /// SyncHandler
+  template <typename Device> void attach(PCIType who, Device &device) {
+    handlers[who] = {[](void *ctx, u64 cycles, Clock &clock) {
+                       return static_cast<Device *>(ctx)->sync(cycles, clock);
+                     },
+                     &device};
+  }
+
+  /// Catches who up to now and schedules the deadline it returns. Devices
+  /// call it before touching their state on register access and again after
+  /// a write that changes their timing.
+  void sync(PCIType who);
+
+  /// Replaces the pending event of who if there is one
+  void schedule(PCIType who, u64 when);
+  void schedule_after(PCIType who, u64 delta) { schedule(who, now + delta); }
+  void cancel(PCIType who);
+  bool scheduled(PCIType who) const;
+
+  /// Syncs every device whose deadline is reached, in deadline order
+  void run_events();
+
+  void update_deadline();
 };
@@ -23,6 +23,7 @@ struct PendingLoad {
 };
 
 enum struct Cause : u32 {
+  interrupt = 0x0,
   syscall = 0x8,
   overflow = 0xc,
   unaligned_load_addr = 0x4,
@@ -65,13 +66,15 @@ struct CPU {
       out_regs[i] = in_regs[i] = 0xdeadbeef;
     }
     memset(cop0.regs, 0, sizeof(u32) * 64);
+    pci.watchpoints.pc = &cur_pc;
+    pci.init_events(clock);
   }
 
   void dump();
 
   int next();
   int dump_and_next();
-  int fetch(Instruction &ins, u32 addr);
+  void fetch(Instruction &ins, u32 addr);
   int decode_execute(const Instruction &instruction);
   int decode_execute_sub(const Instruction &instruction);
   int decode_execute_cop0(const Instruction &instruction);
@@ -85,6 +88,7 @@ struct CPU {
   void set_reg(u32 index, u32 val);
   u32 reg(u32 index);
   bool cache_isolated();
+  bool interrupt_requested();
   int handle_cache(u32 val, u32 addr);
 
   int store8(u8 val, u32 addr);
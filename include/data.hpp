@@ -3,15 +3,31 @@
 #include "types.hpp"
 
 #include <filesystem>
+#include <cstring>
+
+// NOTE: PS1 is little endian, so values can be copied as is iff host is little
+// endian too. Only call these on PS1 memory structures.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "memory accessors assume a little endian host");
 
 namespace memory {
-u32 load32(u8 *data, u32 index);
-u16 load16(u8 *data, u32 index);
-u8 load8(u8 *data, u32 index);
+template <typename T> inline T load(const u8 *data, u32 index) {
+  T val;
+  memcpy(&val, data + index, sizeof(T));
+  return val;
+}
+
+template <typename T> inline void store(u8 *data, u32 index, T val) {
+  memcpy(data + index, &val, sizeof(T));
+}
+
+inline u32 load32(const u8 *data, u32 index) { return load<u32>(data, index); }
+inline u16 load16(const u8 *data, u32 index) { return load<u16>(data, index); }
+inline u8 load8(const u8 *data, u32 index) { return data[index]; }
 
-void store32(u8 *data, u32 index, u32 val);
-void store16(u8 *data, u32 index, u16 val);
-void store8(u8 *data, u32 index, u8 val);
+inline void store32(u8 *data, u32 index, u32 val) { store(data, index, val); }
+inline void store16(u8 *data, u32 index, u16 val) { store(data, index, val); }
+inline void store8(u8 *data, u32 index, u8 val) { data[index] = val; }
 } // namespace memory
 
 namespace file {
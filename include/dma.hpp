@@ -4,10 +4,13 @@
 #include "range.hpp"
 #include "ram.hpp"
 #include "gpu.hpp"
+#include "irq.hpp"
 
-struct DMA : HeapByteData {
+// NOTE: register memory is owned by Arena, see init()
+struct DMA {
   static constexpr u32 size = 0x80;
   static constexpr Range range = {0x1f801080, 0x1f801100};
+  u8 *data = nullptr;
 
   struct Reg {
     /// register indexes
@@ -83,10 +86,63 @@ struct DMA : HeapByteData {
     u32 channel_control;      // copied at initialization
   };
 
+  static constexpr u32 channel_count = 7;
+
+  static constexpr u32 channel_index(ChannelView::Type type) {
+    return static_cast<u32>(type) >> 4;
+  }
+
+  /// Device end of a channel. Transfers hand it whole blocks of count words
+  /// starting at RAM address addr and moving by step (4 or -4), the port
+  /// splits them where RAM wraps. A null handler means the device can't
+  /// transfer in that direction.
+  struct Port {
+    void *device = nullptr;
+    int (*from_ram)(void *device, RAM &ram, u32 addr, u32 count,
+                    u32 step) = nullptr;
+    int (*to_ram)(void *device, RAM &ram, u32 addr, u32 count,
+                  u32 step) = nullptr;
+    /// Whether the next request mode block can go, null means always
+    bool (*ready)(void *device) = nullptr;
+  };
+
   RAM &ram;
   GPU &gpu;
-
-  DMA(RAM &ram, GPU &gpu);
+  IRQ &irq;
+
+  /// Indexed by channel_index()
+  Port ports[channel_count];
+
+  // NOTE: a linked list walk stops when it gets back to a node it already
+  // went through and resumes from sync() resume_delay cycles after it was
+  // stopped, so a list looping onto itself can't hang the emulator. Request
+  // mode transfers waiting on a port that isn't ready resume the same way.
+  u64 resume_delay = 0x1000;
+
+  // NOTE: data moves as soon as a transfer starts, its bus time is charged
+  // to the CPU at once and the channel completes from sync() when that time
+  // has elapsed
+  /// Cycles left per channel before it completes or resumes
+  u64 wait[channel_count] = {0};
+  /// Bus time charged to the CPU by the transfers sync() started, the clock
+  /// already moved past it when sync() returns its delay
+  u64 stalled = 0;
+  /// Bit per channel_index() of the transfers waiting to complete
+  u32 busy = 0;
+  /// Bit per channel_index() of the transfers left active
+  u32 suspended = 0;
+  /// Bit per channel_index() of the transfers waiting for the bus, they
+  /// start by DPCR priority once it is free and their channel is enabled
+  u32 requested = 0;
+
+  DMA(RAM &ram, GPU &gpu, IRQ &irq);
+
+  void attach_port(ChannelView::Type type, Port port) {
+    ports[channel_index(type)] = port;
+  }
+
+  /// Set register memory and its reset values
+  void init(u8 *regs);
 
   // TODO: may not be needed, may create chviews at beginning and track it there
   ChannelView make_channel_view(u32 dma_reg_index); 
@@ -99,8 +155,20 @@ struct DMA : HeapByteData {
   void set_base_addr(u32 base_address_reg_index, u32 val);
 
   //may only be called reg::.*_channel_control when written
-  int try_transfer(ChannelView &channel);
+  void request(ChannelView &channel);
+
+  /// Starts requested transfers in DPCR priority order while the bus is free
+  int arbitrate(Clock &clock);
+
+  /// Moves the data of channel and keeps it busy for the bus time it took
+  int try_transfer(ChannelView &channel, Clock &clock);
+
+  /// Ends the transfer of channel n and sets its interrupt flag
+  void complete(u32 n);
+
+  /// Completes or resumes the transfers that are due, see Clock::sync
+  u64 sync(u64 cycles, Clock &clock);
 
-  int load32(u32 &val, u32 index);
-  int store32(u32 val, u32 index);
+  int load32(u32 &val, u32 index, Clock &clock);
+  int store32(u32 val, u32 index, Clock &clock);
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.hpp"
+#include "arena.hpp"
+
+struct BiosImage;
+
+// NOTE: fastmem reserves a host virtual region as big as the guest physical
+// space (512MB, what is left after masking KSEG0/KSEG1) and maps RAM with its
+// mirrors from the arena memfd and BIOS from its image file into it. A guest
+// physical address is then directly an index into that region, base[addr].
+// Every other page is left unmapped and its page flags are cleared, so
+// accesses to them take the slow path through PCI device dispatch instead of
+// faulting.
+struct FastMem {
+  static constexpr u32 space_size = 0x20000000; // 512MB
+  static constexpr u32 page_shift = 12;         // 4KB
+  static constexpr u32 page_size = 1U << page_shift;
+  static constexpr u32 page_count = space_size >> page_shift;
+
+  // NOTE: read and write are what the fast path checks, mapped_* remember
+  // what the page allows so protect() can restore them. Bits [5:2] hold the
+  // PCIType of the page to look up access costs.
+  struct Page {
+    static constexpr u8 read = 1 << 0;
+    static constexpr u8 write = 1 << 1;
+    static constexpr u8 type_shift = 2;
+    static constexpr u8 type_mask = 0xf;
+    static constexpr u8 mapped_shift = 6;
+    static constexpr u8 mapped_read = read << mapped_shift;
+    static constexpr u8 mapped_write = write << mapped_shift;
+  };
+
+  /// Start of the guest physical space mirror, nullptr if mirroring is off
+  u8 *base = nullptr;
+
+  /// Page::* flags per guest physical page, 0 means slow path
+  u8 page_flags[page_count] = {0};
+
+  FastMem() = default;
+  ~FastMem();
+
+  FastMem(const FastMem &) = delete;
+  FastMem &operator=(const FastMem &) = delete;
+
+  // NOTE: stays disabled if the arena isn't memfd backed or the host doesn't
+  // allow the reservation, in that case every access takes the slow path
+  int init(const Arena &arena, const BiosImage &bios);
+  void release();
+
+  constexpr bool readable(u32 addr) const {
+    return addr < space_size &&
+           (page_flags[addr >> page_shift] & Page::read) != 0;
+  }
+
+  constexpr bool writable(u32 addr) const {
+    return addr < space_size &&
+           (page_flags[addr >> page_shift] & Page::write) != 0;
+  }
+
+  // NOTE: only valid for readable or writable addresses
+  constexpr u32 page_type(u32 addr) const {
+    return (page_flags[addr >> page_shift] >> Page::type_shift) &
+           Page::type_mask;
+  }
+
+  /// Send accesses of the given kinds (Page::read/write) to the page of addr
+  /// through the slow path, other kinds go back to the fast path if mapped
+  void protect(u32 addr, u8 kinds);
+};
@@ -5,6 +5,11 @@
 #include "range.hpp"
 #include "renderer.hpp"
 #include "clock.hpp"
+#include "irq.hpp"
+
+#include <cstddef>
+
+struct Timers;
 
 enum struct GP0mode {
   command,
@@ -70,16 +75,71 @@ constexpr HorizontalRes hres_from_fields(u8 hr1, u8 hr2) {
   };
 }
 
+/// 1MB of video memory, 1024x512 16bit pixels. Memory is owned by Arena.
+struct VRAM {
+  static constexpr u32 width = 1024;
+  static constexpr u32 height = 512;
+  static constexpr u32 size = width * height * sizeof(u16);
+  u16 *data = nullptr;
+};
+
+/// Rectangle of VRAM moved by an image load (GP0 0xA0) or store (GP0 0xC0),
+/// walked row by row. Coordinates wrap around VRAM edges.
+struct VRAMTransfer {
+  u16 x = 0;
+  u16 y = 0;
+  u16 width = 0;
+  u16 height = 0;
+
+  /// Next pixel, relative to x and y
+  u16 col = 0;
+  u16 row = 0;
+
+  constexpr bool done() const { return row >= height; }
+};
+
+/// Rectangle from the destination/source word and the size word of GP0
+/// 0xA0/0xC0, a size of 0 means the whole VRAM dimension
+constexpr VRAMTransfer vram_transfer_from_gp0(u32 coord, u32 size) {
+  return {
+      .x = static_cast<u16>(coord & (VRAM::width - 1)),
+      .y = static_cast<u16>((coord >> 16) & (VRAM::height - 1)),
+      .width = static_cast<u16>((((size & 0xffff) - 1) & (VRAM::width - 1)) + 1),
+      .height =
+          static_cast<u16>((((size >> 16) - 1) & (VRAM::height - 1)) + 1),
+  };
+}
+
 struct GPU {
   static constexpr u32 size = 8;
   static constexpr Range range = {0x1f801810, 0x1f801818};
   u8 data[size];
 
   Renderer *renderer;
+  IRQ &irq;
+
+  /// Told about blanking edges for the timer sync modes, see Timers::blank
+  Timers *timers = nullptr;
 
-  GPU(Renderer *renderer, VideoMode configured_hardware_video_mode)
-      : renderer(renderer),
-        configured_hardware_video_mode(configured_hardware_video_mode) {}
+  VRAM vram;
+
+  /// Rectangle of the image load in progress
+  VRAMTransfer vram_load;
+
+  /// Rectangle of the image store in progress, done() when there is none
+  VRAMTransfer vram_store;
+
+  /// Last word of the image store read by the CPU or DMA, GPUREAD keeps
+  /// returning it once the store is done
+  u32 read_latch = 0;
+
+  GPU(Renderer *renderer, IRQ &irq, VideoMode configured_hardware_video_mode)
+      : renderer(renderer), irq(irq),
+        configured_hardware_video_mode(configured_hardware_video_mode) {
+    // NOTE: the crystal is fixed, only the line and dot timings change
+    video_clock = ClockDomain::from_hz(clock_hz());
+    update_timings();
+  }
 
   /// Texture page base X coordinate (4 bits, 64 byte increment)
   u8 page_base_x = 0;
@@ -198,13 +258,24 @@ struct GPU {
   /// True when VBLANK interrupt is high
   bool vblank_interrupt = false;
 
-  /// NOTE: Use 16bits for the fractional part of the clock ratio to get good
-  /// precision
-  static constexpr u64 clock_ratio_frac = 0x10000;
+  /// Frames (or fields) output so far, incremented at the start of vblank
+  u64 frame_count = 0;
+
+  /// GPU video clock, its rate depends on the hardware crystal
+  ClockDomain video_clock;
+
+  /// Line rate, what timer 1 counts with the "hsync" clock source
+  ClockDomain hblank;
 
-  /// Fractional GPU cycle remainder resulting from the CPU clock/GPU clock time
-  /// conversion
-  u16 gpu_clock_frac = 0;
+  /// Dot rate for the current horizontal resolution, what timer 0 counts
+  /// with the "dotclock" source
+  ClockDomain dot_clock;
+
+  /// GPU clock cycles per line for the current video mode
+  u16 line_ticks = 0;
+
+  /// Lines per frame (or field) for the current video mode
+  u16 frame_lines = 0;
 
   /// Currently displayed video output line
   u16 display_line = 0;
@@ -218,6 +289,19 @@ struct GPU {
   u32 status();
   u32 read();
   int gp0(u32 val);
+
+  /// Same as gp0() for each word, but commands that are whole in the span run
+  /// directly and image data is consumed in one go
+  int gp0_batch(const u32 *words, size_t n);
+
+  /// Writes the next n words (2 pixels each) of the image load in progress,
+  /// pixels past its end are dropped
+  void load_words(const u32 *words, size_t n);
+
+  /// Reads the next n words (2 pixels each) of the image store in progress,
+  /// words past its end read 0. DMA fills whole blocks with it, GPUREAD one
+  /// word at a time.
+  void store_words(u32 *words, size_t n);
   int gp1(u32 val, Clock &clock);
 
   int load32(u32 &val, u32 index, Clock &clock);
@@ -225,10 +309,35 @@ struct GPU {
 
   // GPU timings
   void vmode_timings(u16 &horizontal, u16 &vertical);
-  u64 gpu_to_cpu_clock_ratio();
-  void clock_sync(Clock &clock);
-  bool in_vblank();
-  void predict_next_clock_sync(Clock &clock);
+
+  /// Recomputes the line and dot clock domains and line timings, call when
+  /// the video mode changes
+  void update_timings();
+
+  /// Video clock rate of the hardware crystal
+  constexpr u64 clock_hz() const {
+    return configured_hardware_video_mode == VideoMode::ntsc
+               ? ClockRate::gpu_ntsc
+               : ClockRate::gpu_pal;
+  }
+
+  /// Video clock cycles per dot for the current horizontal resolution
+  constexpr u32 dot_divider() const {
+    // NOTE: bit 0 is the 368 pixels mode, it overrides the others
+    if ((hres.val & 1) != 0)
+      return 7;
+
+    constexpr u32 dividers[4] = {10, 8, 5, 4}; // 256, 320, 512, 640
+    return dividers[hres.val >> 1];
+  }
+  /// Catches up the video beam, see Clock::sync
+  u64 sync(u64 cycles, Clock &clock);
+  bool in_vblank() const;
+  bool in_hblank() const;
+
+  /// CPU cycles until the next vblank edge, or hblank edge when timer 0
+  /// synchronizes on it
+  u64 next_sync_delay();
 
   u16 displayed_vram_line();
 };
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "types.hpp"
+#include "range.hpp"
+#include "clock.hpp"
+
+/// Interrupt lines, bit index in I_STAT and I_MASK
+enum struct Interrupt : u32 {
+  vblank = 0,
+  gpu = 1,
+  cdrom = 2,
+  dma = 3,
+  timer0 = 4,
+  timer1 = 5,
+  timer2 = 6,
+  pad_memcard = 7,
+  sio = 8,
+  spu = 9,
+  lightpen = 10,
+};
+
+// IRQ stands for interrupt request
+// 0x1f801070 register is for: Interrupt Status
+// 0x1f801074 register is for: Interrupt Mask
+// NOTE: pending is only recomputed when I_STAT or I_MASK change. When it
+// rises the clock deadline is forced so the CPU notices at the same point it
+// checks for events, there is no polling per instruction.
+struct IRQ {
+  static constexpr u32 size = 8;
+  static constexpr Range range = {0x1f801070, 0x1f801078};
+
+  struct Reg {
+    static constexpr u32 status = 0x0;
+    static constexpr u32 mask = 0x4;
+  };
+
+  // NOTE: only [0:10] are significant
+  static constexpr u32 lines = 0x7ff;
+
+  u32 status = 0;
+  u32 mask = 0;
+
+  /// (I_STAT & I_MASK) != 0, drives CAUSE bit 10 of the CPU
+  bool pending = false;
+
+  /// Bound by PCI::init_events
+  Clock *clock = nullptr;
+
+  /// Edges are detected by the devices, raising sets the I_STAT bit
+  void raise(Interrupt line) {
+    status |= 1U << static_cast<u32>(line);
+    update();
+  }
+
+  void update() {
+    bool was_pending = pending;
+    pending = (status & mask) != 0;
+
+    if (pending && !was_pending && clock != nullptr) {
+      clock->request_break();
+    }
+  }
+
+  int load(u32 &val, u32 index);
+  int store(u32 val, u32 index);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.hpp"
+#include "gpu.hpp"
+
+#include <chrono>
+
+/// Keeps emulated frames in step with host time
+struct FramePacer {
+  using HostClock = std::chrono::steady_clock;
+
+  enum struct Mode : u8 {
+    normal,
+    uncapped,     // NOTE: never waits
+    fast_forward, // NOTE: normal speed times speed_factor
+  };
+
+  // NOTE: sleeping overshoots by up to a scheduler quantum, the last part of
+  // the wait spins instead
+  static constexpr std::chrono::microseconds spin_threshold{1500};
+
+  // NOTE: after falling behind by this many frames (debugger, window drag)
+  // the pacer restarts from now instead of running fast to catch up
+  static constexpr u32 max_lag_frames = 4;
+
+  Mode mode = Mode::normal;
+  u32 speed_factor = 4;
+
+  /// Host time the current frame should end at
+  HostClock::time_point deadline;
+  bool started = false;
+
+  /// Host time of one emulated frame (or field), follows the GPU video mode
+  HostClock::duration frame_period(const GPU &gpu) const;
+
+  /// Waits for the end of the current frame, call once per emulated frame
+  void end_frame(const GPU &gpu);
+};
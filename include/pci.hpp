@@ -2,26 +2,65 @@
 
 #include "range.hpp"
 #include "types.hpp"
-#include "heap_byte_data.hpp"
+#include "arena.hpp"
+#include "fastmem.hpp"
+#include "watchpoint.hpp"
 #include "dma.hpp"
 #include "ram.hpp"
 #include "gpu.hpp"
+#include "timers.hpp"
+#include "irq.hpp"
 #include "peripheral.hpp"
 #include "clock.hpp"
 #include "log.hpp"
 #include "instruction.hpp"
+#include "data.hpp"
 
 #include <cstdlib>
 #include <cstring>
 
-// TODO:  remove HeapByteData struct and allocate all memory at once
-
 // TODO: may remove size constants
 
+// NOTE: memory is owned by BiosImage
 struct Bios {
   static constexpr u32 size = 524288;
   static constexpr Range range = {0x1fc00000, 0x1fc80000};
-  u8 data[size];
+  const u8 *data = nullptr;
+};
+
+// NOTE: the BIOS file is mapped read-only instead of copied, so every
+// instance, even in other processes, shares the same page cache pages
+struct BiosImage {
+  int fd = -1;
+  const u8 *data = nullptr;
+
+  BiosImage() = default;
+  ~BiosImage();
+
+  BiosImage(const BiosImage &) = delete;
+  BiosImage &operator=(const BiosImage &) = delete;
+
+  int load(const char *path);
+  void release();
+};
+
+/// Index of per-width tables: u8, u16, u32
+template <typename T> constexpr u32 bus_width_index() {
+  static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4);
+  return sizeof(T) >> 1;
+}
+
+// NOTE: 1KB data cache used as fast RAM. It is only reachable from KUSEG and
+// KSEG0, not from KSEG1, DMA or instruction fetch. Memory is owned by Arena.
+struct Scratchpad {
+  static constexpr u32 size = 1024;
+  static constexpr Range range = {0x1f800000, 0x1f800400};
+  u8 *data = nullptr;
+
+  // NOTE: takes an unmasked address, KSEG1 mirror 0xbf800000 doesn't match
+  static constexpr bool reachable(u32 addr) {
+    return (addr & 0x7ffffc00) == range.beg;
+  }
 };
 
 // This is not our ram size, but a register that is being set in hw_regs area    
@@ -38,13 +77,38 @@ struct RamSize {
 struct HWregs {
   static constexpr u32 size = 36;
   static constexpr Range range = {0x1f801000, 0x1f801024};
-  u8 data[size];
+  u8 data[size] = {0};
+
+  struct Reg {
+    static constexpr u32 expansion1_base = 0x00;
+    static constexpr u32 expansion2_base = 0x04;
+    static constexpr u32 expansion1_delay = 0x08;
+    static constexpr u32 expansion3_delay = 0x0c;
+    static constexpr u32 bios_delay = 0x10;
+    static constexpr u32 spu_delay = 0x14;
+    static constexpr u32 cdrom_delay = 0x18;
+    static constexpr u32 expansion2_delay = 0x1c;
+    static constexpr u32 com_delay = 0x20;
+  };
+
+  /// Extra CPU cycles of an access by PCIType and width, see bus_width_index.
+  /// Decoded from the delay registers only when they're written so accesses
+  /// just look it up.
+  u8 access_cost[PCIType::SIZE][3] = {};
+
+  HWregs();
+
+  void decode_timings();
+
+  template <typename T> constexpr u32 cost(u32 type) const {
+    return access_cost[type][bus_width_index<T>()];
+  }
 
   inline int store32(u32 val, u32 index) {
     static constexpr const char *fn = "HWregs::store32";
     
     switch (index) {
-    case 0:
+    case Reg::expansion1_base:
       if (val != 0x1f000000) {
         LOG_ERROR("[FN:%s IND:%d VAL:0x%08x] Bad expansion 1 value", fn, index,
                   val);
@@ -53,7 +117,7 @@ struct HWregs {
 
       return 0;
 
-    case 4:
+    case Reg::expansion2_base:
       if (val != 0x1f802000) {
         LOG_ERROR("[FN:%s IND:%d VAL:0x%08x] Bad expansion 2 value", fn, index,
                   val);
@@ -63,7 +127,9 @@ struct HWregs {
       return 0;
     }
 
-    LOG_DEBUG("[FN:%s IND:%d VAL:0x%08x] Ignored", fn, index, val);
+    // NOTE: expansion 3 and CDROM delays are kept but have no region yet
+    memory::store32(data, index, val);
+    decode_timings();
     return 0;
   }
 };
@@ -79,16 +145,16 @@ struct CacheCtrl {
   bool tag_test_mode() { return (val & 4) != 0; }
 };
 
-struct SPU : HeapByteData {
+// NOTE: memory is owned by Arena
+struct SPU {
   static constexpr u32 size = 640;
   static constexpr Range range = {0x1f801c00, 0x1f801e80};
-  SPU() : HeapByteData(size) {}
+  u8 *data = nullptr;
 };
 
-struct Expansion1 : HeapByteData {
-  static constexpr u32 size = 8388608; // 8MB
+// NOTE: has no storage, loads return constants, see bus::regions
+struct Expansion1 {
   static constexpr Range range = {0x1f000000, 0x1f800000};
-  Expansion1() : HeapByteData(size) {} 
 };
 
 struct Expansion2 {
@@ -97,71 +163,368 @@ struct Expansion2 {
   u8 data[size];
 };
 
-// NOTE: writes are ignored for these registers and return 0
-// IRQ stands for interrupt request
-// 0x1f801070 register is for: Interrupt Status 
-// 0x1f801074 register is for: Interrupt Mask
-struct IRQ {
-  static constexpr u32 size = 8;
-  static constexpr Range range = {0x1f801070, 0x1f801078};
-  u8 data[size];
+enum struct BusOp {
+  load,
+  store,
 };
 
-struct Timers {
-  static constexpr u32 size = 48;
-  static constexpr Range range = {0x1f801100, 0x1f801130};
-  u8 data[size];
+/// What to do with an access of a given width to a region
+enum struct BusPolicy : u8 {
+  handle, // NOTE: passed to the device, see PCI::device_access
+  ignore, // NOTE: loads return BusRegion::ignore_val, stores are dropped
+  error,
+};
 
-  struct Reg {
-    struct Pixel {
-      static constexpr u32 current = 0x00;
-      static constexpr u32 mode = 0x04;
-      static constexpr u32 target = 0x08;
-    };
-    struct HSync {
-      static constexpr u32 current = 0x10;
-      static constexpr u32 mode = 0x14;
-      static constexpr u32 target = 0x18;
-    };
-    struct Eighth {
-      static constexpr u32 current = 0x20;
-      static constexpr u32 mode = 0x24;
-      static constexpr u32 target = 0x28;
-    };
-  };
+/// Policies are indexed by access width, see bus_width_index
+struct BusRegion {
+  PCIType type;
+  Range range;
+  const char *name;
+  BusPolicy load[3];
+  BusPolicy store[3];
+  u32 ignore_val;
+};
+
+namespace bus {
+constexpr BusPolicy handle = BusPolicy::handle;
+constexpr BusPolicy ignore = BusPolicy::ignore;
+constexpr BusPolicy error = BusPolicy::error;
+
+// NOTE: regions outside of the I/O page, ordered by access frequency, not by
+// address. First match wins so ranges must not overlap.
+inline constexpr BusRegion regions[] = {
+    {PCIType::ram, RAM::range, "RAM",
+     {handle, handle, handle}, {handle, handle, handle}, 0},
+    {PCIType::bios, Bios::range, "Bios",
+     {handle, handle, handle}, {error, error, error}, 0},
+    {PCIType::cache_ctrl, CacheCtrl::range, "CacheCtrl",
+     {error, error, error}, {error, error, handle}, 0},
+    {PCIType::expansion1, Expansion1::range, "Expansion1",
+     {ignore, error, error}, {error, error, error}, 0xff},
 };
 
+/// All hardware registers live in this 8KB page
+inline constexpr Range io_range = {0x1f801000, 0x1f803000};
+
+// NOTE: regions inside io_range, found through io_slots instead of a search
+inline constexpr BusRegion io_regions[] = {
+    {PCIType::gpu, GPU::range, "GPU",
+     {error, error, handle}, {error, error, handle}, 0},
+    {PCIType::dma, DMA::range, "DMA",
+     {error, error, handle}, {error, error, handle}, 0},
+    {PCIType::timers, Timers::range, "Timers",
+     {error, handle, handle}, {error, handle, handle}, 0},
+    {PCIType::irq, IRQ::range, "IRQ",
+     {error, handle, handle}, {error, handle, handle}, 0},
+    {PCIType::spu, SPU::range, "SPU",
+     {error, ignore, error}, {error, ignore, error}, 0},
+    {PCIType::hw_regs, HWregs::range, "HWregs",
+     {error, error, error}, {error, error, handle}, 0},
+    {PCIType::ram_size, RamSize::range, "RamSize",
+     {error, error, error}, {error, error, ignore}, 0},
+    // TODO: Rustation ignores store32 to expansion2
+    {PCIType::expansion2, Expansion2::range, "Expansion2",
+     {error, error, error}, {ignore, error, error}, 0},
+};
+
+constexpr u32 io_region_count = sizeof(io_regions) / sizeof(io_regions[0]);
+
+/// Every 16 bytes of the I/O page has a slot holding the index of its region
+/// in io_regions, or no_region
+constexpr u32 io_slot_shift = 4;
+constexpr u32 io_slot_count = (io_range.end - io_range.beg) >> io_slot_shift;
+constexpr u8 no_region = 0xff;
+
+struct IOslots {
+  u8 slot[io_slot_count];
+};
+
+constexpr IOslots make_io_slots() {
+  IOslots slots = {};
+
+  for (u32 i = 0; i < io_slot_count; ++i) {
+    slots.slot[i] = no_region;
+  }
+
+  for (u32 r = 0; r < io_region_count; ++r) {
+    const Range &range = io_regions[r].range;
+
+    for (u32 addr = range.beg; addr < range.end; addr += 1U << io_slot_shift) {
+      slots.slot[(addr - io_range.beg) >> io_slot_shift] = r;
+    }
+  }
+
+  return slots;
+}
+
+inline constexpr IOslots io_slots = make_io_slots();
+
+constexpr bool io_regions_fit() {
+  for (const BusRegion &region : io_regions) {
+    if (region.range.beg < io_range.beg || region.range.end > io_range.end ||
+        (region.range.beg & ((1U << io_slot_shift) - 1)) != 0)
+      return false;
+  }
+
+  return true;
+}
+
+static_assert(io_regions_fit(), "I/O regions must be slot aligned in the page");
+
+/// NOTE: index is set to the offset in the found region
+constexpr const BusRegion *find_region(u32 &index, u32 addr) {
+  if (io_range.offset(index, addr) == 0) {
+    u8 slot = io_slots.slot[index >> io_slot_shift];
+
+    // NOTE: a region may end in the middle of its last slot
+    if (slot != no_region &&
+        io_regions[slot].range.offset(index, addr) == 0) {
+      return &io_regions[slot];
+    }
+
+    return nullptr;
+  }
+
+  for (const BusRegion &region : regions) {
+    if (region.range.offset(index, addr) == 0)
+      return &region;
+  }
+
+  return nullptr;
+}
+
+inline constexpr u32 region_mask[8] = {
+    // KUSEG: 2048MB
+    0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+    // KSEG0: 512MB
+    0x7fffffff,
+    // KSEG1: 512MB
+    0x1fffffff,
+    // KSEG2: 1024MB
+    0xffffffff, 0xffffffff};
+
+constexpr u32 mask_addr_to_region(u32 addr) {
+  return addr & region_mask[addr >> 29];
+}
+
+// NOTE: rare paths, kept out of line and cold so the string formatting
+// doesn't end up in the callers
+[[gnu::cold, gnu::noinline]] int unhandled(BusOp op, u32 width, u32 addr,
+                                           u32 val, const char *what);
+[[gnu::cold, gnu::noinline]] int ignored(BusOp op, u32 width, u32 addr,
+                                         u32 &val, const BusRegion &region);
+} // namespace bus
+
 // Peripheral Component Interconnect
 struct PCI {
+  Arena arena;
+  FastMem fastmem;
   Bios bios;
+  Scratchpad scratchpad;
   HWregs hw_regs;
   RamSize ram_size;
   CacheCtrl cache_ctrl;
   RAM ram;
+  IRQ irq;
   GPU gpu;
   SPU spu;
   Expansion1 expansion1;
   Expansion2 expansion2;
-  IRQ irq;
   Timers timers;
   DMA dma;
+  Watchpoints watchpoints;
 
-  PCI(Bios &&bios, Renderer *renderer, VideoMode configured_hardware_video_mode)
-      : bios(bios), gpu(renderer, configured_hardware_video_mode),
-        dma(ram, gpu) {}
+  // NOTE: sticky, set by any access that fails and never cleared by the bus.
+  // Accesses return values directly so callers don't branch on a status per
+  // access, the CPU checks this once per instruction instead.
+  bool fault = false;
+
+  PCI(const BiosImage &bios_image, Renderer *renderer,
+      VideoMode configured_hardware_video_mode, bool fastmem_enabled = true);
 
   PCI(const PCI &pci) = delete;
   PCI &operator=(const PCI &pci) = delete;
 
-  void clock_sync(Clock &clock);
+  /// Attaches timed devices to the clock and schedules their first sync
+  void init_events(Clock &clock);
+
+  /// Ticks the wait states of the region, on top of CPU fetch cycles.
+  /// Unhandled addresses raise the fault flag and fetch a NOP.
+  void load_instruction(Instruction &ins, u32 addr, Clock &clock);
+
+  /// Single bus path for every load and store width. val is zero extended
+  /// on loads and truncated to T on stores. Only scratchpad and fastmem are
+  /// inlined, everything else goes through slow_access.
+  template <BusOp op, typename T>
+  void access(u32 &val, u32 addr, Clock &clock);
+
+  template <BusOp op, typename T>
+  [[gnu::noinline]] void slow_access(u32 &val, u32 addr, Clock &clock);
 
-  int load_instruction(Instruction &ins, u32 addr);
+  template <BusOp op, typename T>
+  int dispatch(u32 &val, u32 addr, Clock &clock);
 
-  int load32(u32 &val, u32 addr, Clock &clock);
-  int load16(u32 &val, u32 addr);
-  int load8(u32 &val, u32 addr);
+  template <BusOp op, typename T>
+  int device_access(const BusRegion &region, u32 &val, u32 index,
+                    Clock &clock);
 
-  int store32(u32 val, u32 addr, Clock &clock);
-  int store16(u16 val, u32 addr);
-  int store8(u8 val, u32 addr);
+  /// Watch physical or virtual addresses, kinds are Watchpoint::Kind::*
+  int watch(u32 addr, u32 len, u8 kinds);
+  int unwatch(u32 addr);
+
+  template <typename T> u32 load(u32 addr, Clock &clock) {
+    // NOTE: unhandled loads leave it untouched, they read 0
+    u32 val = 0;
+    access<BusOp::load, T>(val, addr, clock);
+    return val;
+  }
+
+  template <typename T> void store(T val, u32 addr, Clock &clock) {
+    u32 v = val;
+    access<BusOp::store, T>(v, addr, clock);
+  }
 };
+
+template <BusOp op, typename T>
+inline void PCI::access(u32 &val, u32 addr, Clock &clock) {
+  if (Scratchpad::reachable(addr)) {
+    u32 index = addr & (Scratchpad::size - 1);
+
+    if constexpr (op == BusOp::load) {
+      val = memory::load<T>(scratchpad.data, index);
+    } else {
+      memory::store<T>(scratchpad.data, index, static_cast<T>(val));
+    }
+
+    return;
+  }
+
+  addr = bus::mask_addr_to_region(addr);
+
+  if constexpr (op == BusOp::load) {
+    if (fastmem.readable(addr)) {
+      val = memory::load<T>(fastmem.base, addr);
+      clock.tick(hw_regs.cost<T>(fastmem.page_type(addr)));
+      return;
+    }
+  } else {
+    if (fastmem.writable(addr)) {
+      memory::store<T>(fastmem.base, addr, static_cast<T>(val));
+      clock.tick(hw_regs.cost<T>(fastmem.page_type(addr)));
+      // NOTE: RAM is the only writable fastmem region
+      ram.mark_dirty(addr);
+      return;
+    }
+  }
+
+  slow_access<op, T>(val, addr, clock);
+}
+
+template <BusOp op, typename T>
+void PCI::slow_access(u32 &val, u32 addr, Clock &clock) {
+  if (dispatch<op, T>(val, addr, clock) < 0) {
+    fault = true;
+  }
+
+  if (watchpoints.count != 0) {
+    u8 kind = op == BusOp::load ? Watchpoint::Kind::read
+                                : Watchpoint::Kind::write;
+    watchpoints.check(kind, addr, sizeof(T) * 8, val, clock.now);
+  }
+}
+
+template <BusOp op, typename T>
+inline int PCI::dispatch(u32 &val, u32 addr, Clock &clock) {
+  u32 index;
+  const BusRegion *region = bus::find_region(index, addr);
+
+  if (region == nullptr) {
+    return bus::unhandled(op, sizeof(T) * 8, addr, val, "Unhandled");
+  }
+
+  clock.tick(hw_regs.cost<T>(region->type));
+
+  const BusPolicy *policy = op == BusOp::load ? region->load : region->store;
+
+  switch (policy[bus_width_index<T>()]) {
+  case BusPolicy::handle:
+    return device_access<op, T>(*region, val, index, clock);
+  case BusPolicy::ignore:
+    return bus::ignored(op, sizeof(T) * 8, addr, val, *region);
+  case BusPolicy::error:
+    break;
+  }
+
+  return bus::unhandled(op, sizeof(T) * 8, addr, val, region->name);
+}
+
+template <BusOp op, typename T>
+inline int PCI::device_access(const BusRegion &region, u32 &val, u32 index,
+                              Clock &clock) {
+  switch (region.type) {
+  case PCIType::ram:
+    index &= RAM::size - 1;
+    if constexpr (op == BusOp::load) {
+      val = memory::load<T>(ram.data, index);
+    } else {
+      memory::store<T>(ram.data, index, static_cast<T>(val));
+      ram.mark_dirty(index);
+    }
+    return 0;
+
+  case PCIType::bios:
+    if constexpr (op == BusOp::load) {
+      val = memory::load<T>(bios.data, index);
+      return 0;
+    }
+    break;
+
+  case PCIType::gpu:
+    if constexpr (op == BusOp::load) {
+      return gpu.load32(val, index, clock);
+    } else {
+      return gpu.store32(val, index, clock);
+    }
+
+  case PCIType::dma:
+    if constexpr (op == BusOp::load) {
+      return dma.load32(val, index, clock);
+    } else {
+      return dma.store32(val, index, clock);
+    }
+
+  case PCIType::irq:
+    if constexpr (op == BusOp::load) {
+      return irq.load(val, index);
+    } else {
+      return irq.store(val, index);
+    }
+
+  case PCIType::timers:
+    if constexpr (op == BusOp::load) {
+      return timers.load(val, index, clock);
+    } else {
+      return timers.store(val, index, clock);
+    }
+
+  case PCIType::hw_regs:
+    if constexpr (op == BusOp::store) {
+      return hw_regs.store32(val, index);
+    }
+    break;
+
+  case PCIType::cache_ctrl:
+    if constexpr (op == BusOp::store) {
+      cache_ctrl.val = val;
+      return 0;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  // NOTE: bus::regions says handle but there is no handler
+  return bus::unhandled(op, sizeof(T) * 8, region.range.beg + index, val,
+                        region.name);
+}
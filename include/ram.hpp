@@ -1,12 +1,52 @@
 #pragma once
 
-#include "heap_byte_data.hpp"
 #include "types.hpp"
 #include "range.hpp"
 
-struct RAM : HeapByteData {
+#include <cstring>
+
+// NOTE: memory is owned by Arena, see PCI
+struct RAM {
   static constexpr u32 size = 2097152; // 2MB
-  static constexpr Range range = {0x00000000, 0x00200000};
-  RAM() : HeapByteData(size, 0xca) {} // initial garbage content value
-};
+  // NOTE: 2MB RAM is mirrored 4 times in the first 8MB
+  static constexpr Range range = {0x00000000, 0x00800000};
+  u8 *data = nullptr;
+
+  /// Dirty page tracking granularity, 4KB
+  static constexpr u32 dirty_page_shift = 12;
+  static constexpr u32 dirty_page_count = size >> dirty_page_shift;
+  static constexpr u32 dirty_words = dirty_page_count / 64;
+
+  /// One bit per page written since the last take_dirty(). Every write path
+  /// (CPU stores and DMA) marks it, so snapshots, rewind and code cache
+  /// invalidation know what changed.
+  u64 dirty[dirty_words] = {0};
+
+  // NOTE: index may be a mirror address, it is masked here
+  constexpr void mark_dirty(u32 index) {
+    u32 page = (index & (size - 1)) >> dirty_page_shift;
+    dirty[page >> 6] |= u64{1} << (page & 63);
+  }
 
+  constexpr void mark_dirty(u32 index, u32 len) {
+    if (len == 0)
+      return;
+
+    for (u32 at = index; at < index + len; at += 1U << dirty_page_shift) {
+      mark_dirty(at);
+    }
+
+    mark_dirty(index + len - 1);
+  }
+
+  constexpr bool is_dirty(u32 page) const {
+    return (dirty[page >> 6] >> (page & 63) & 1) != 0;
+  }
+
+  /// Copy the dirty bitmap to out and clear it in one go, meant to be called
+  /// once per frame between instructions
+  void take_dirty(u64 out[dirty_words]) {
+    memcpy(out, dirty, sizeof(dirty));
+    memset(dirty, 0, sizeof(dirty));
+  }
+};
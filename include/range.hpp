@@ -6,5 +6,12 @@ struct Range {
   u32 beg;
   u32 end;
 
-  int offset(u32 &out, u32 addr) const;
+  constexpr int offset(u32 &out, u32 addr) const {
+    if (addr >= beg && addr < end) {
+      out = addr - beg;
+      return 0;
+    }
+
+    return -1;
+  }
 };
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "types.hpp"
+#include "range.hpp"
+#include "clock.hpp"
+#include "gpu.hpp"
+#include "irq.hpp"
+
+/// One of the three root counters
+struct RootCounter {
+  struct Mode {
+    static constexpr u16 sync_enable = 1 << 0;
+    static constexpr u16 sync_mode_shift = 1;
+    static constexpr u16 reset_on_target = 1 << 3;
+    static constexpr u16 irq_on_target = 1 << 4;
+    static constexpr u16 irq_on_overflow = 1 << 5;
+    static constexpr u16 irq_repeat = 1 << 6;
+    static constexpr u16 irq_toggle = 1 << 7;
+    static constexpr u16 source_shift = 8;
+    // NOTE: active low
+    static constexpr u16 irq_request = 1 << 10;
+    // NOTE: both reached bits are cleared when the mode is read
+    static constexpr u16 reached_target = 1 << 11;
+    static constexpr u16 reached_overflow = 1 << 12;
+    static constexpr u16 writable = 0x3ff;
+  };
+
+  u16 counter = 0;
+  u16 mode = Mode::irq_request;
+  u16 target = 0;
+
+  /// Converts CPU cycles into ticks of the selected clock source
+  ClockDomain source;
+
+  /// Stopped by its sync mode
+  bool paused = false;
+
+  /// One-shot IRQ already raised since the last mode write
+  bool irq_fired = false;
+
+  /// Last known state of the blanking signal the sync modes of counters 0
+  /// (hblank) and 1 (vblank) follow
+  bool blanking = false;
+
+  constexpr u32 sync_mode() const { return (mode >> Mode::sync_mode_shift) & 3; }
+  constexpr u32 clock_source() const { return (mode >> Mode::source_shift) & 3; }
+};
+
+// NOTE: counters aren't ticked, they are caught up by Clock::sync when read
+// or written and the deadline is the nearest target/overflow IRQ of the
+// three counters.
+struct Timers {
+  static constexpr u32 size = 48;
+  static constexpr Range range = {0x1f801100, 0x1f801130};
+  static constexpr u32 count = 3;
+
+  struct Reg {
+    // NOTE: each counter has its registers 0x10 bytes apart
+    static constexpr u32 counter_shift = 4;
+    static constexpr u32 current = 0x00;
+    static constexpr u32 mode = 0x04;
+    static constexpr u32 target = 0x08;
+  };
+
+  /// Counter 0 can count dots and counter 1 lines
+  const GPU &gpu;
+  IRQ &irq;
+
+  RootCounter counters[count];
+
+  Timers(const GPU &gpu, IRQ &irq) : gpu(gpu), irq(irq) {}
+
+  Timers(const Timers &) = delete;
+  Timers &operator=(const Timers &) = delete;
+
+  int load(u32 &val, u32 index, Clock &clock);
+  int store(u32 val, u32 index, Clock &clock);
+
+  /// Catches every counter up, see Clock::sync
+  u64 sync(u64 cycles, Clock &clock);
+
+  void sync_counter(u32 n, u64 cycles);
+  void set_mode(u32 n, u16 val);
+
+  /// Called by the GPU with the current blanking state, catches the counters
+  /// up and applies the sync modes of counters 0 and 1 on edges
+  void blank(bool hblank, bool vblank, Clock &clock);
+  void set_blanking(u32 n, bool blanking);
+
+  /// Timer 0 synchronizes on hblank, the GPU has to report every edge
+  bool wants_hblank() const {
+    return (counters[0].mode & RootCounter::Mode::sync_enable) != 0;
+  }
+
+  /// CPU cycles until the next IRQ of any counter
+  u64 next_irq_delay() const;
+  void raise_irq(u32 n);
+};
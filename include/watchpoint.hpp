@@ -0,0 +1,51 @@
+#pragma once
+
+#include "types.hpp"
+
+// NOTE: watched pages have their fastmem flags cleared for the watched kinds
+// so only accesses to them take the slow path, where they're checked against
+// the list. Unwatched accesses don't pay anything. Addresses are physical so
+// every KUSEG/KSEG0/KSEG1 view of them matches, RAM mirrors are watched
+// separately. Scratchpad is not on the bus and can't be watched.
+struct Watchpoint {
+  // NOTE: same values as FastMem::Page::read/write
+  struct Kind {
+    static constexpr u8 read = 1 << 0;
+    static constexpr u8 write = 1 << 1;
+  };
+
+  u32 addr;
+  u32 len;
+  u8 kinds;
+};
+
+struct WatchHit {
+  u32 pc;
+  u32 addr;
+  u32 width;
+  u32 val;
+  u64 cycle;
+  u8 kind;
+};
+
+struct Watchpoints {
+  static constexpr u32 capacity = 16;
+
+  Watchpoint list[capacity];
+  u32 count = 0;
+
+  /// PC of the instruction being executed, bound by the CPU
+  const u32 *pc = nullptr;
+
+  /// Most recent hits, hit_count keeps counting past capacity
+  WatchHit hits[capacity];
+  u32 hit_count = 0;
+
+  int add(u32 addr, u32 len, u8 kinds);
+  int remove(u32 addr);
+
+  /// Union of watched kinds in the page containing addr
+  u8 kinds_in_page(u32 addr, u32 page_shift) const;
+
+  void check(u8 kind, u32 addr, u32 width, u32 val, u64 cycle);
+};
@@ -0,0 +1,175 @@
+#include "arena.hpp"
+#include "pci.hpp"
+#include "log.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr u32 align_up(u32 val, u32 alignment) {
+  return (val + alignment - 1) & ~(alignment - 1);
+}
+
+// NOTE: RAM is the hottest region so it gets a whole huge page on its own, the
+// rest is grouped after it by size. Offsets must stay page aligned for the
+// regions FastMem maps.
+// NOTE: BIOS is not here, it is shared between instances, see BiosImage
+constexpr u32 ram_offset = 0;
+constexpr u32 vram_offset = ram_offset + RAM::size;
+constexpr u32 scratchpad_offset = vram_offset + VRAM::size;
+constexpr u32 spu_offset = align_up(scratchpad_offset + Scratchpad::size,
+                                    FastMem::page_size);
+constexpr u32 dma_offset = align_up(spu_offset + SPU::size, 16);
+constexpr u32 arena_size = align_up(dma_offset + DMA::size, Arena::alignment);
+
+static_assert(ram_offset % Arena::alignment == 0);
+
+constexpr const char *shmem_thp_path =
+    "/sys/kernel/mm/transparent_hugepage/shmem_enabled";
+
+/// Whether MADV_HUGEPAGE does anything for memfd memory, the active setting
+/// is the bracketed one
+bool shmem_huge_pages_enabled() {
+  FILE *file = fopen(shmem_thp_path, "r");
+  if (file == nullptr)
+    return false;
+
+  char buf[128] = {0};
+  size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+  fclose(file);
+  buf[len] = '\0';
+
+  return strstr(buf, "[advise]") != nullptr ||
+         strstr(buf, "[always]") != nullptr ||
+         strstr(buf, "[within_size]") != nullptr ||
+         strstr(buf, "[force]") != nullptr;
+}
+
+u8 *map_aligned(u32 size, int fd) {
+  u8 *at = Arena::reserve(size);
+  if (at == nullptr)
+    return nullptr;
+
+  void *mem;
+  if (fd >= 0) {
+    mem = mmap(at, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+  } else {
+    mem = mmap(at, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+  }
+
+  if (mem == MAP_FAILED) {
+    munmap(at, size);
+    return nullptr;
+  }
+
+  return static_cast<u8 *>(mem);
+}
+
+} // namespace
+
+Arena::~Arena() { release(); }
+
+u8 *Arena::reserve(u32 size) {
+  // NOTE: over-reserve to find an aligned start, then trim the rest
+  u64 reserved = u64{size} + alignment;
+  void *mem = mmap(nullptr, reserved, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mem == MAP_FAILED)
+    return nullptr;
+
+  uintptr_t beg = reinterpret_cast<uintptr_t>(mem);
+  uintptr_t mask = alignment - 1;
+  uintptr_t aligned = (beg + mask) & ~mask;
+
+  if (aligned != beg) {
+    munmap(mem, aligned - beg);
+  }
+
+  uintptr_t tail = aligned + size;
+  uintptr_t end = beg + reserved;
+  if (tail != end) {
+    munmap(reinterpret_cast<void *>(tail), end - tail);
+  }
+
+  return reinterpret_cast<u8 *>(aligned);
+}
+
+int Arena::init() {
+  size = arena_size;
+
+  fd = memfd_create("ps1time", MFD_CLOEXEC);
+  if (fd >= 0 && ftruncate(fd, size) < 0) {
+    close(fd);
+    fd = -1;
+  }
+
+  if (fd < 0) {
+    LOG_WARN("memfd is not available, arena is anonymous memory");
+  }
+
+  data = map_aligned(size, fd);
+  if (data == nullptr) {
+    LOG_CRITICAL("Failed to allocate %u bytes of emulated memory", size);
+    release();
+    return -1;
+  }
+
+#ifdef MADV_HUGEPAGE
+  // NOTE: only a hint, anonymous memory follows the regular THP setting but
+  // a memfd needs shmem_enabled too
+  madvise(data, size, MADV_HUGEPAGE);
+
+  if (fd >= 0 && !shmem_huge_pages_enabled()) {
+    LOG_INFO("Huge pages need advise in %s, arena uses regular pages",
+             shmem_thp_path);
+  }
+#endif
+
+  ram = data + ram_offset;
+  vram = data + vram_offset;
+  scratchpad = data + scratchpad_offset;
+  spu = data + spu_offset;
+  dma = data + dma_offset;
+
+  return 0;
+}
+
+void Arena::release() {
+  if (data != nullptr) {
+    munmap(data, size);
+    data = nullptr;
+  }
+
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+
+  ram = vram = scratchpad = spu = dma = nullptr;
+}
+
+u64 Arena::resident() const {
+  if (data == nullptr)
+    return 0;
+
+  const u64 page_size = sysconf(_SC_PAGESIZE);
+  const u64 pages = (size + page_size - 1) / page_size;
+  std::vector<unsigned char> residency(pages);
+
+  if (mincore(data, size, residency.data()) < 0) {
+    LOG_ERROR("Failed to query arena residency");
+    return 0;
+  }
+
+  u64 count = 0;
+  for (unsigned char page : residency) {
+    count += page & 1;
+  }
+
+  return count * page_size;
+}
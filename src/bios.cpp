@@ -0,0 +1,46 @@
+#include "pci.hpp"
+#include "log.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+BiosImage::~BiosImage() { release(); }
+
+int BiosImage::load(const char *path) {
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR("Unable to open BIOS image file '%s'", path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size != Bios::size) {
+    LOG_ERROR("Bad BIOS image size, expected %u bytes", Bios::size);
+    release();
+    return -1;
+  }
+
+  void *mem = mmap(nullptr, Bios::size, PROT_READ, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED) {
+    LOG_ERROR("Failed to map BIOS image");
+    release();
+    return -1;
+  }
+
+  data = static_cast<const u8 *>(mem);
+  return 0;
+}
+
+void BiosImage::release() {
+  if (data != nullptr) {
+    munmap(const_cast<u8 *>(data), Bios::size);
+    data = nullptr;
+  }
+
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
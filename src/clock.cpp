@@ -0,0 +1,80 @@
+#include "clock.hpp"
+#include "log.hpp"
+
+void Clock::sync(PCIType who) {
+  const Handler &handler = handlers[who];
+  if (handler.fn == nullptr) {
+    LOG_ERROR("No sync handler for device %d", who);
+    cancel(who);
+    return;
+  }
+
+  u64 delay = handler.fn(handler.ctx, states[who].sync(now), *this);
+
+  // NOTE: 0 would keep run_events on the same device forever
+  if (delay == 0) {
+    delay = 1;
+  }
+
+  if (delay == never) {
+    cancel(who);
+  } else {
+    schedule_after(who, delay);
+  }
+}
+
+void Clock::schedule(PCIType who, u64 when) {
+  cancel(who);
+
+  u32 i = event_count;
+  while (i > 0 && events[i - 1].deadline > when) {
+    events[i] = events[i - 1];
+    --i;
+  }
+
+  events[i] = {when, who};
+  ++event_count;
+  update_deadline();
+}
+
+void Clock::cancel(PCIType who) {
+  for (u32 i = 0; i < event_count; ++i) {
+    if (events[i].who != who)
+      continue;
+
+    for (u32 j = i + 1; j < event_count; ++j) {
+      events[j - 1] = events[j];
+    }
+
+    --event_count;
+    update_deadline();
+    return;
+  }
+}
+
+bool Clock::scheduled(PCIType who) const {
+  for (u32 i = 0; i < event_count; ++i) {
+    if (events[i].who == who)
+      return true;
+  }
+
+  return false;
+}
+
+void Clock::run_events() {
+  break_requested = false;
+
+  while (event_count != 0 && events[0].deadline <= now) {
+    sync(events[0].who);
+  }
+
+  update_deadline();
+}
+
+void Clock::update_deadline() {
+  if (break_requested) {
+    next_deadline = 0;
+  } else {
+    next_deadline = event_count != 0 ? events[0].deadline : never;
+  }
+}
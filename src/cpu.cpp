@@ -40,13 +40,30 @@ void CPU::dump() {
 
 bool CPU::cache_isolated() { return (cop0.regs[COP0::Reg::sr] & 0x10000) != 0; }
 
+// Interrupt controller line on IP2 (CAUSE bit 10), taken when both the
+// current interrupt enable (SR bit 0) and its mask (SR bit 10) are set
+bool CPU::interrupt_requested() {
+  u32 sr = cop0.regs[COP0::Reg::sr];
+  return pci.irq.pending && (sr & 1) != 0 && (sr & (1 << 10)) != 0;
+}
+
 int CPU::dump_and_next() {
   dump();
   return next();
 }
 
 int CPU::next() {
-  pci.clock_sync(clock);
+  // NOTE: interrupts also force the deadline, see IRQ::update
+  if (clock.due()) {
+    clock.run_events();
+
+    if (interrupt_requested()) {
+      cur_pc = pc;
+      in_delay_slot = branch_ocurred;
+      branch_ocurred = false;
+      return exception(Cause::interrupt);
+    }
+  }
   
   // save cur pc here in case of expceiton for EPC
   cur_pc = pc;
@@ -57,9 +74,7 @@ int CPU::next() {
   }
   
   Instruction instruction;
-  int cpu_fetch_result = fetch(instruction, cur_pc);
-  // REVIEW: instruction fetch may be said to be always succeed
-  assert(cpu_fetch_result == 0);
+  fetch(instruction, cur_pc);
 
   pc = next_pc;
   next_pc += 4;
@@ -73,8 +88,10 @@ int CPU::next() {
   in_delay_slot = branch_ocurred;
   branch_ocurred = false;
 
+  // NOTE: bus faults are sticky and only checked here, once per
+  // instruction, so loads and stores don't return a status
   int cpu_exec_result = decode_execute(instruction);
-  if (cpu_exec_result) {
+  if (cpu_exec_result || pci.fault) {
     dump();
     return -1;
   }
@@ -88,19 +105,19 @@ int CPU::next() {
   return 0;
 }
 
-int CPU::fetch(Instruction &ins, u32 addr) {
+void CPU::fetch(Instruction &ins, u32 addr) {
   CacheCtrl &cc = pci.cache_ctrl;
   bool is_kseg1 = (addr & 0xe0000000) == 0xa0000000;
 
   if (is_kseg1 || !cc.icache_enabled()) {
     clock.tick(4);
-    return pci.load_instruction(ins, addr);
+    pci.load_instruction(ins, addr, clock);
+    return;
   }
 
   u32 tag = addr & 0xfffff000;
   ICacheLine &line = icache[(addr >> 4) & 0xff];
   u32 index = (addr >> 2) & 0b11;
-  int status = 0;
 
   if (line.tag() != tag || line.first_valid_index() > index) {
     // cache miss, fetch icache line
@@ -109,15 +126,12 @@ int CPU::fetch(Instruction &ins, u32 addr) {
     
     for (int i = index; i < 4; ++i) {
       clock.tick(1);
-      
-      // REVIEW: instruction fetch may be said to be always succeed
-      status |= pci.load_instruction(line.instruction[i], addr);
+      pci.load_instruction(line.instruction[i], addr, clock);
       addr += 4;
     }
   }
 
   ins = line.instruction[index];
-  return status;
 }
 
 int CPU::store8(u8 val, u32 addr) {
@@ -126,7 +140,8 @@ int CPU::store8(u8 val, u32 addr) {
     return -1;
   }
 
-  return pci.store8(val, addr);
+  pci.store<u8>(val, addr, clock);
+  return 0;
 }
 
 int CPU::store16(u16 val, u32 addr) {
@@ -135,7 +150,8 @@ int CPU::store16(u16 val, u32 addr) {
     return -1;
   }
 
-  return pci.store16(val, addr);
+  pci.store<u16>(val, addr, clock);
+  return 0;
 }
 
 int CPU::store32(u32 val, u32 addr) {
@@ -143,7 +159,8 @@ int CPU::store32(u32 val, u32 addr) {
     return handle_cache(val, addr);
   }
 
-  return pci.store32(val, addr, clock);
+  pci.store<u32>(val, addr, clock);
+  return 0;
 }
 
 int CPU::handle_cache(u32 val, u32 addr) {
@@ -373,6 +390,7 @@ int CPU::exception(const Cause &cause) {
   // Update `CAUSE` register with the exception code (bits
   // [6:2])
   cop0.regs[COP0::Reg::cause] = static_cast<u32>(cause) << 2;
+  cop0.regs[COP0::Reg::cause] |= static_cast<u32>(pci.irq.pending) << 10;
 
   // Save current instruction address in `EPC`
   cop0.regs[COP0::Reg::epc] = cur_pc;
@@ -480,6 +498,11 @@ int CPU::mtc0(const Instruction &i) {
   // NOTE: cop0 doesn't have in reg out reg concept because of load delay
   cop0.regs[cop_r] = val;
 
+  // NOTE: may have unmasked a pending interrupt
+  if (cop_r == COP0::Reg::sr && pci.irq.pending) {
+    clock.request_break();
+  }
+
   return 0;
 }
 
@@ -525,7 +548,8 @@ int CPU::lw(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  return pci.load32(pending_load.val, addr, clock);
+  pending_load.val = pci.load<u32>(addr, clock);
+  return 0;
 }
 
 int CPU::sltu(const Instruction &i) {
@@ -579,9 +603,8 @@ int CPU::lb(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  int status = pci.load8(pending_load.val, addr);
-  pending_load.val = static_cast<i8>(pending_load.val);
-  return status;
+  pending_load.val = static_cast<i8>(pci.load<u8>(addr, clock));
+  return 0;
 }
 
 int CPU::beq(const Instruction &i) {
@@ -599,8 +622,13 @@ int CPU::mfc0(const Instruction &i) {
   u32 val;
 
   switch (cop_r) {
-  case COP0::Reg::sr:
   case COP0::Reg::cause:
+    // NOTE: IP2 follows the interrupt controller
+    pending_load.reg_index = i.rt();
+    pending_load.val = (cop0.regs[cop_r] & ~(1U << 10)) |
+                       (static_cast<u32>(pci.irq.pending) << 10);
+    return 0;
+  case COP0::Reg::sr:
   case COP0::Reg::epc:
     pending_load.reg_index = i.rt();
     pending_load.val = cop0.regs[cop_r];
@@ -653,7 +681,8 @@ int CPU::lbu(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  return pci.load8(pending_load.val, addr);
+  pending_load.val = pci.load<u8>(addr, clock);
+  return 0;
 }
 
 int CPU::jalr(const Instruction &i) {
@@ -806,6 +835,11 @@ int CPU::rfe(const Instruction &i) {
   cop0.regs[COP0::Reg::sr] &= ~0x3f;
   cop0.regs[COP0::Reg::sr] |= mode >> 2;
 
+  // NOTE: may have re-enabled interrupts
+  if (pci.irq.pending) {
+    clock.request_break();
+  }
+
   return 0;
 }
 
@@ -818,7 +852,8 @@ int CPU::lhu(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  return pci.load16(pending_load.val, addr);
+  pending_load.val = pci.load<u16>(addr, clock);
+  return 0;
 }
 
 int CPU::sllv(const Instruction &i) {
@@ -835,9 +870,8 @@ int CPU::lh(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  int status = pci.load16(pending_load.val, addr);
-  pending_load.val = static_cast<i16>(pending_load.val);
-  return status;
+  pending_load.val = static_cast<i16>(pci.load<u16>(addr, clock));
+  return 0;
 }
 
 int CPU::nor(const Instruction &i) {
@@ -911,10 +945,7 @@ int CPU::lwl(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  u32 aligned_word;
-  int status = pci.load32(aligned_word, aligned_addr, clock);
-  if (status < 0)
-    return status;
+  u32 aligned_word = pci.load<u32>(aligned_addr, clock);
 
   switch (unaligned_addr & 0b11) {
   case 0:
@@ -944,10 +975,7 @@ int CPU::lwr(const Instruction &i) {
 
   pending_load.reg_index = i.rt();
 
-  u32 aligned_word;
-  int status = pci.load32(aligned_word, aligned_addr, clock);
-  if (status < 0)
-    return status;
+  u32 aligned_word = pci.load<u32>(aligned_addr, clock);
 
   switch (unaligned_addr & 0b11) {
   case 0:
@@ -972,10 +1000,7 @@ int CPU::swl(const Instruction &i) {
   u32 aligned_addr = unaligned_addr & 0b00;
   u32 cur_reg_val = reg(i.rt());
 
-  u32 cur_mem_val;
-  int status = pci.load32(cur_mem_val, aligned_addr, clock);
-  if (status < 0)
-    return status;
+  u32 cur_mem_val = pci.load<u32>(aligned_addr, clock);
 
   u32 new_mem_val;
   switch (unaligned_addr & 0b11) {
@@ -1001,10 +1026,7 @@ int CPU::swr(const Instruction &i) {
   u32 aligned_addr = unaligned_addr & 0b00;
   u32 cur_reg_val = reg(i.rt());
 
-  u32 cur_mem_val;
-  int status = pci.load32(cur_mem_val, aligned_addr, clock);
-  if (status < 0)
-    return status;
+  u32 cur_mem_val = pci.load<u32>(aligned_addr, clock);
 
   u32 new_mem_val;
   switch (unaligned_addr & 0b11) {
@@ -4,46 +4,6 @@
 #include <filesystem>
 #include <cassert>
 
-// TODO: can just use memcpy here, values are little endian anyway iff passed an
-// internal PS1 value, just be careful that these functions are only called on
-// PS1 memory structures
-
-namespace memory {
-// little endian
-u32 load32(u8 *data, u32 index) {
-  u32 b0 = data[index];
-  u32 b1 = data[index + 1];
-  u32 b2 = data[index + 2];
-  u32 b3 = data[index + 3];
-
-  return (b3 << 24) | (b2 << 16) | (b1 << 8) | b0;
-}
-
-u16 load16(u8 *data, u32 index) {
-  u16 b0 = data[index];
-  u16 b1 = data[index + 1];
-
-  return (b1 << 8) | b0;
-}
-
-u8 load8(u8 *data, u32 index) { return data[index]; }
-
-void store32(u8 *data, u32 index, u32 val) {
-  data[index] = val & 0xff;
-  data[index + 1] = (val >> 8) & 0xff;
-  data[index + 2] = (val >> 16) & 0xff;
-  data[index + 3] = val >> 24;
-}
-
-void store16(u8 *data, u32 index, u16 val) {
-  data[index] = val & 0xff;
-  data[index + 1] = val >> 8;
-}
-
-void store8(u8 *data, u32 index, u8 val) { data[index] = val; }
-
-} // namespace memory
-
 namespace file {
 int read_file(u8 *out, const std::filesystem::path path, const u32 size) {
   int status = 0;
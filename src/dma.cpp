@@ -5,6 +5,10 @@
 
 #include <assert.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace chview {
 namespace {
 
@@ -24,6 +28,10 @@ bool transfer_enabled(const DMA::ChannelView &chview) {
   return bit(chview.channel_control, 24) != 0;
 }
 
+bool chopping_enabled(const DMA::ChannelView &chview) {
+  return bit(chview.channel_control, 8) != 0;
+}
+
 // TODO: check all asserts and handle more gracefully?
 DMA::ChannelView::SyncMode sync_mode(const DMA::ChannelView &chview) {
   switch (bits_in_range(chview.channel_control, 9, 10)) {
@@ -70,20 +78,22 @@ void finalize_transfer(DMA::ChannelView &chview) {
   bit_clear(chview.channel_control, 24);
   bit_clear(chview.channel_control, 28);
 
-  // TODO: Need to set the more values here for other fields, particularly
-  // interrupts (according to simias)
+  // NOTE: interrupt flags are set by DMA::complete once the transfer time
+  // has elapsed
 }
 
 void sync(const DMA::ChannelView &chview) {
   memory::store32(chview.channel_control_addr, 0, chview.channel_control);
 }
 
-// NOTE: same as transfer_block_size() but used in SyncMode::manual
-u32 transfer_word_count(const DMA::ChannelView &chview) {
-  return bits_in_range(chview.block_control, 0, 15);
+// NOTE: base address and block control sit right before channel control
+void sync_progress(const DMA::ChannelView &chview) {
+  memory::store32(chview.channel_control_addr - 8, 0, chview.base_address);
+  memory::store32(chview.channel_control_addr - 4, 0, chview.block_control);
 }
 
-// NOTE: same as transfer_word_count() but used in SyncMode::request
+// NOTE: used in SyncMode::request, manual mode gets its word count from
+// transfer_size()
 u32 transfer_block_size(const DMA::ChannelView &chview) {
   return bits_in_range(chview.block_control, 0, 15);
 }
@@ -98,8 +108,6 @@ u32 transfer_block_count(const DMA::ChannelView &chview) {
 // for DMA
 namespace {
 
-using transfer_value_generator = u32 (*)(u32, u32);
-
 // REVIEW: make it a variable?
 // TODO: It seems that this value depends on the ram configuration. We are
 // currently using 2MB ram (0x200000) so we can mask all ram addresses with
@@ -110,89 +118,157 @@ constexpr u32 mask_reg_index_to_chview_type_val(u32 reg_index) {
   return reg_index & 0xfffffff0;
 }
 
-constexpr u32 get_otc_channel_transfer_value(u32 remaining_size, u32 addr) {
-  // REVIEW: this value is for end of linked list but a specific loop could be
-  // written for OTC which would remove this check
-  // REVIEW: looping by decrementing so 1 is valid, is there a more beautiful
-  // way?
-  if (remaining_size == 1) {
-    return 0xffffff;
+constexpr u32 otc_end_of_table = 0xffffff;
+
+// REVIEW: bus cycles per 0x100 words from nocash, PIO is a guess and CD-ROM
+// depends on the bus width set in COM_DELAY
+constexpr u32 word_cycles_per_256[DMA::channel_count] = {
+    0x110,  // MDEC in
+    0x110,  // MDEC out
+    0x110,  // GPU
+    0x1800, // CD-ROM
+    0x420,  // SPU
+    0x1400, // PIO
+    0x110,  // OTC
+};
+
+// REVIEW: reading a header and jumping to the next node costs more than a
+// word, couldn't find a figure
+constexpr u32 list_node_cycles = 8;
+
+/// Bus cycles a channel takes to move count words
+constexpr u64 transfer_cycles(DMA::ChannelView::Type type, u64 count) {
+  return (count * word_cycles_per_256[DMA::channel_index(type)] + 0xff) >> 8;
+}
+
+/// Writes the entries of [lo, hi] (word aligned, no RAM wrap in between) each
+/// pointing to the previous word
+void fill_otc_run(u8 *ram, u32 lo, u32 hi) {
+  const u32 mask = ram_addr_align_mask();
+  u32 addr = lo;
+
+#ifdef __SSE2__
+  // NOTE: 4 entries per store, lane i holds addr + 4 * i - 4 masked so the
+  // entry at 0 points to the end of RAM
+  const __m128i lane_mask = _mm_set1_epi32(mask);
+  const __m128i step = _mm_set1_epi32(16);
+  __m128i val = _mm_setr_epi32(addr - 4, addr, addr + 4, addr + 8);
+
+  for (; addr <= hi && hi - addr >= 12; addr += 16) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ram + addr),
+                     _mm_and_si128(val, lane_mask));
+    val = _mm_add_epi32(val, step);
   }
+#endif
 
-  return (addr - 4) & ram_addr_align_mask();
+  for (; addr <= hi; addr += 4) {
+    memory::store32(ram, addr, (addr - 4) & mask);
+  }
 }
 
-transfer_value_generator get_generator(DMA::ChannelView::Type type) {
-  switch (type) {
-  case DMA::ChannelView::Type::OTC:
-    return get_otc_channel_transfer_value;
-  default:
-    LOG_ERROR("Unhandled DMA source port %d", type);
-    return nullptr;
+/// Clears an ordering table, count entries going down from start, each
+/// pointing to the one below and the last ending the list
+void fill_otc(RAM &ram, u32 start, u32 count) {
+  const u32 mask = ram_addr_align_mask();
+
+  if (count == 0)
+    return;
+
+  start &= mask;
+  u32 last = (start - 4 * (count - 1)) & mask;
+
+  // NOTE: entries above last are written going up, split where the table
+  // wraps around the end of RAM
+  if (count > 1) {
+    u32 first = (last + 4) & mask;
+
+    if (first <= start) {
+      fill_otc_run(ram.data, first, start);
+      ram.mark_dirty(first, start + 4 - first);
+    } else {
+      fill_otc_run(ram.data, first, mask);
+      fill_otc_run(ram.data, 0, start);
+      ram.mark_dirty(first, mask + 4 - first);
+      ram.mark_dirty(0, start + 4);
+    }
   }
+
+  memory::store32(ram.data, last, otc_end_of_table);
+  ram.mark_dirty(last);
 }
 
-constexpr u32 get_otc_channel_transfer_value_see_note_about_transfer_manual(
-    u32 remaining_size, u32 aligned_addr) {
-  if (remaining_size == 1) {
-    return 0xffffff;
+/// GPU port, hands the words to GP0 as contiguous spans, only split where
+/// they wrap around the end of RAM
+int gpu_from_ram(void *device, RAM &ram, u32 addr, u32 count, u32 step) {
+  GPU &gpu = *static_cast<GPU *>(device);
+  const u32 *words = reinterpret_cast<const u32 *>(ram.data);
+
+  if (step != 4) {
+    // NOTE: going down, words aren't contiguous for GP0
+    for (; count > 0; --count) {
+      int status = gpu.gp0(memory::load32(ram.data, addr));
+      if (status < 0)
+        return status;
+      addr = (addr + step) & ram_addr_align_mask();
+    }
+
+    return 0;
   }
 
-  return (aligned_addr - 4);
-}
+  while (count > 0) {
+    u32 until_end = (ram_addr_align_mask() + 4 - addr) / 4;
+    u32 span = count < until_end ? count : until_end;
 
-transfer_value_generator
-get_generator_see_note_about_transfer_manual(DMA::ChannelView::Type type) {
-  switch (type) {
-  case DMA::ChannelView::Type::OTC:
-    return get_otc_channel_transfer_value_see_note_about_transfer_manual;
-  default:
-    LOG_ERROR("Unhandled DMA source port %d", type);
-    return nullptr;
-  }
-}
-
-// REVIEW: so this is my implementation of manual transfer. simias does manual
-// and request mode on the same function and I think it is wrong by code path
-// but also by means of implementation because it doesn't seem to take account
-// of block sizes being different than 4(?). I plan to split manual and request
-// too. Another thing is that, and also valid for duckstation, they seem to be
-// uselessly masking to align address. They mask at the start to align for 32bit
-// access and address seems to be staying multiples of 4 because in manual mode
-// increment is either 4 or -4 and in request mode block size gets multiplied
-// with 4 or -4 so it is still aligned. they also always mask for OTC channel
-// transfer value and my point is valid for there too. I dumped ram with both
-// implementations and diff results with nothing. Yet, to follow simias's guide,
-// I leave this here with an extra function for OTC channel get value.
-int transfer_manual(const DMA &dma, DMA::ChannelView &chview) {
-  const u32 addr_mask = ram_addr_align_mask();
-  const u32 step = chview::addr_step(chview);
-  const transfer_value_generator generator =
-      get_generator_see_note_about_transfer_manual(chview.type);
-  const u32 word_count = chview::transfer_word_count(chview);
-  u32 cur_addr = chview.base_address & addr_mask;
-
-  if (generator == nullptr)
-    return -1;
+    int status = gpu.gp0_batch(words + addr / 4, span);
+    if (status < 0)
+      return status;
 
-  if (chview::direction_from_ram(chview)) {
-    LOG_ERROR("Unhandled DMA direction");
-    return -1;
-  } else {
+    count -= span;
+    addr = 0;
+  }
+
+  return 0;
+}
 
-    for (u32 i = word_count; i > 0; --i) {
-      u32 value = generator(i, cur_addr);
-      memory::store32(dma.ram.data, cur_addr, value);
-      cur_addr += step;
+/// GPU port, copies the image store in progress straight from VRAM into
+/// RAM spans, only split where they wrap around the end of RAM
+int gpu_to_ram(void *device, RAM &ram, u32 addr, u32 count, u32 step) {
+  GPU &gpu = *static_cast<GPU *>(device);
+  u32 *words = reinterpret_cast<u32 *>(ram.data);
+
+  if (step != 4) {
+    // NOTE: going down, words aren't contiguous for VRAM rows
+    for (; count > 0; --count) {
+      gpu.store_words(words + addr / 4, 1);
+      ram.mark_dirty(addr);
+      addr = (addr + step) & ram_addr_align_mask();
     }
+
+    return 0;
   }
 
-  chview::finalize_transfer(chview);
+  while (count > 0) {
+    u32 until_end = (ram_addr_align_mask() + 4 - addr) / 4;
+    u32 span = count < until_end ? count : until_end;
+
+    gpu.store_words(words + addr / 4, span);
+    ram.mark_dirty(addr, span * 4);
+
+    count -= span;
+    addr = 0;
+  }
+
+  return 0;
+}
 
+/// OTC port, always goes down whatever the step bit says
+int otc_to_ram(void *, RAM &ram, u32 addr, u32 count, u32) {
+  fill_otc(ram, addr, count);
   return 0;
 }
 
-int transfer_linked_list(const DMA &dma, DMA::ChannelView &chview) {
+int transfer_linked_list(const DMA &dma, DMA::ChannelView &chview,
+                         u64 &cycles) {
 
   if(!chview::direction_from_ram(chview)) {
     LOG_ERROR("Invalid DMA direction for linked list mode");
@@ -204,42 +280,75 @@ int transfer_linked_list(const DMA &dma, DMA::ChannelView &chview) {
     return -1;
   }
 
+  const DMA::Port &port = dma.ports[DMA::channel_index(chview.type)];
   u32 aligned_addr = chview.base_address & ram_addr_align_mask();
+  u32 nodes = 0;
+  u32 words = 0;
   u32 header;
 
-  do {
-    memcpy(&header, dma.ram.data + aligned_addr, sizeof(u32));
-
-    u32 remaining_size = header >> 24;
-
-    while (remaining_size > 0) {
-      aligned_addr = (aligned_addr + 4) &
-             ram_addr_align_mask(); // REVIEW: masking should'nt bee needed
-
-      u32 command;
-      memcpy(&command, dma.ram.data + aligned_addr, sizeof(u32));
-
-      int status = dma.gpu.gp0(command);
-      if (status < 0)
-        return status;
-
-      --remaining_size;
+  // NOTE: Brent's cycle detection, mark is compared against each next node
+  // and moves to it after 1, 2, 4, ... steps. A list that gets back to a
+  // node never ends on hardware, a valid one is always walked whole.
+  u32 mark = aligned_addr;
+  u32 mark_steps = 0;
+  u32 mark_power = 1;
+
+  while (true) {
+    header = memory::load32(dma.ram.data, aligned_addr);
+    u32 next_addr = header & ram_addr_align_mask();
+
+    // NOTE: the next header is a dependent load, start fetching it while the
+    // GPU consumes this payload
+    if ((header & 0x800000) == 0) {
+      __builtin_prefetch(dma.ram.data + next_addr);
     }
 
-    aligned_addr = header & ram_addr_align_mask();
+    // NOTE: the payload follows the header
+    u32 payload_addr = (aligned_addr + 4) & ram_addr_align_mask();
+    int status = port.from_ram(port.device, dma.ram, payload_addr,
+                               header >> 24, 4);
+    if (status < 0)
+      return status;
+
+    ++nodes;
+    words += header >> 24;
+    aligned_addr = next_addr;
 
     // REVIEW: end-of-table marker is 0xffffff but
     // mednafen only checks MSB but this is not valid addr
     // maybe hardware does the same gotta check
-  } while ((header & 0x800000) == 0);
+    if ((header & 0x800000) != 0)
+      break;
+
+    if (aligned_addr == mark) {
+      // NOTE: the channel stays busy with its base address on the next node
+      // like on hardware, DMA::try_transfer notices and schedules the rest
+      chview.base_address = aligned_addr;
+      chview::sync_progress(chview);
+      cycles = transfer_cycles(chview.type, words) + nodes * list_node_cycles;
+      return 0;
+    }
+
+    if (++mark_steps == mark_power) {
+      mark = aligned_addr;
+      mark_steps = 0;
+      mark_power <<= 1;
+    }
+  }
 
+  // NOTE: hardware leaves the end marker of the last header in there
+  chview.base_address = otc_end_of_table;
+  chview::sync_progress(chview);
   chview::finalize_transfer(chview);
+  cycles = transfer_cycles(chview.type, words) + nodes * list_node_cycles;
 
   return 0;
 }
 
-// TODO: not quite right, see transfer_manual and its review
-int transfer_manual_and_request(const DMA &dma, DMA::ChannelView &chview) {
+int transfer_manual_and_request(const DMA &dma, DMA::ChannelView &chview,
+                                u64 &cycles) {
+  const DMA::Port &port = dma.ports[DMA::channel_index(chview.type)];
+  const bool from_ram = chview::direction_from_ram(chview);
   const u32 increment = chview::addr_step(chview);
   u32 cur_addr = chview.base_address;
   u32 remaining_size;
@@ -249,54 +358,107 @@ int transfer_manual_and_request(const DMA &dma, DMA::ChannelView &chview) {
     return -1;
   }
 
-  if (chview::direction_from_ram(chview)) {
-    while (remaining_size > 0) {
-      u32 aligned_addr = cur_addr & ram_addr_align_mask();
-
-      u32 src_word;
-      memcpy(&src_word, dma.ram.data + aligned_addr, sizeof(u32));
+  auto handler = from_ram ? port.from_ram : port.to_ram;
+  if (handler == nullptr) {
+    // NOTE: words sent to a missing device are only lost, but RAM would be
+    // left with garbage the other way
+    LOG_ERROR("Unhandled DMA %s port %d", from_ram ? "destination" : "source",
+              chview.type);
+    if (!from_ram)
+      return -1;
 
-      switch (chview.type) {
-      case DMA::ChannelView::Type::GPU:
-        dma.gpu.gp0(src_word);
-        break;
-      default:
-        LOG_ERROR("Unhandled DMA destination port %d", chview.type);
-      }
+    chview::finalize_transfer(chview);
+    return 0;
+  }
 
-      cur_addr += increment;
-      --remaining_size;
+  if (chview::sync_mode(chview) == DMA::ChannelView::SyncMode::manual ||
+      port.ready == nullptr) {
+    int status = handler(port.device, dma.ram, cur_addr & ram_addr_align_mask(),
+                         remaining_size, increment);
+    if (status < 0)
+      return status;
+
+    // NOTE: manual mode leaves the registers alone, request mode ends like
+    // the block by block path below
+    if (chview::sync_mode(chview) == DMA::ChannelView::SyncMode::request) {
+      chview.base_address = (cur_addr + remaining_size * increment) & 0xffffff;
+      bits_copy_to_range(chview.block_control, 16, 31, 0);
+      chview::sync_progress(chview);
     }
-  } else {
-    const transfer_value_generator generator = get_generator(chview.type);
-    if (generator == nullptr)
-      return -1;
-
-    while (remaining_size > 0) {
-      // NOTE: it seems like addr may be bad duckstation handles similar to
-      // this
-      u32 aligned_addr = cur_addr & ram_addr_align_mask();
-      u32 src_word = generator(remaining_size, aligned_addr);
 
-      // load 32bit directly
-      memory::store32(dma.ram.data, aligned_addr, src_word);
+    chview::finalize_transfer(chview);
+    cycles = transfer_cycles(chview.type, remaining_size);
+    return 0;
+  }
 
-      cur_addr += increment;
-      --remaining_size;
+  const u32 block_size = chview::transfer_block_size(chview);
+  u32 blocks = chview::transfer_block_count(chview);
+  u32 moved = 0;
+
+  for (; blocks > 0; --blocks) {
+    if (!port.ready(port.device)) {
+      // NOTE: the channel stays busy with the remaining blocks like on
+      // hardware, DMA::try_transfer notices and schedules the rest
+      cycles = transfer_cycles(chview.type, moved);
+      chview.base_address = cur_addr & 0xffffff;
+      bits_copy_to_range(chview.block_control, 16, 31, blocks);
+      chview::sync_progress(chview);
+      return 0;
     }
+
+    int status = handler(port.device, dma.ram, cur_addr & ram_addr_align_mask(),
+                         block_size, increment);
+    if (status < 0)
+      return status;
+
+    cur_addr += block_size * increment;
+    moved += block_size;
   }
 
+  chview.base_address = cur_addr & 0xffffff;
+  bits_copy_to_range(chview.block_control, 16, 31, 0);
+  chview::sync_progress(chview);
   chview::finalize_transfer(chview);
+  cycles = transfer_cycles(chview.type, moved);
 
   return 0;
 }
 
-int transfer(const DMA &dma, DMA::ChannelView &chview) {
+constexpr bool channel_enabled(u32 control, u32 n) {
+  return bit(control, 4 * n + 3) != 0;
+}
+
+constexpr u32 channel_priority(u32 control, u32 n) {
+  return bits_in_range(control, 4 * n, 4 * n + 2);
+}
+
+/// Requested and enabled channel that gets the bus next, -1 if there is none.
+/// Priority 0 is the highest, ties go to the higher channel.
+int next_channel(u32 control, u32 requested) {
+  int next = -1;
+  u32 best = 0;
+
+  for (u32 n = 0; n < DMA::channel_count; ++n) {
+    if ((requested & (1U << n)) == 0 || !channel_enabled(control, n))
+      continue;
+
+    u32 priority = channel_priority(control, n);
+    if (next < 0 || priority <= best) {
+      next = n;
+      best = priority;
+    }
+  }
+
+  return next;
+}
+
+/// Moves the data right away and sets cycles to the bus time it took
+int transfer(const DMA &dma, DMA::ChannelView &chview, u64 &cycles) {
   switch (chview::sync_mode(chview)) {
   case DMA::ChannelView::SyncMode::linked_list:
-    return transfer_linked_list(dma, chview);
+    return transfer_linked_list(dma, chview, cycles);
   default:
-    return transfer_manual_and_request(dma, chview);
+    return transfer_manual_and_request(dma, chview, cycles);
   }
 
   return 0;
@@ -304,12 +466,23 @@ int transfer(const DMA &dma, DMA::ChannelView &chview) {
 
 } // namespace
 
-DMA::DMA(RAM &ram, GPU &gpu) : HeapByteData(size, 0), ram(ram), gpu(gpu) {
+DMA::DMA(RAM &ram, GPU &gpu, IRQ &irq) : ram(ram), gpu(gpu), irq(irq) {
+  // NOTE: MDEC, CD-ROM, SPU and PIO have no device yet, their ports stay
+  // unconnected
+  attach_port(ChannelView::Type::GPU, {&gpu, gpu_from_ram, gpu_to_ram});
+  attach_port(ChannelView::Type::OTC, {this, nullptr, otc_to_ram});
+}
+
+void DMA::init(u8 *regs) {
+  data = regs;
+  memset(data, 0, size);
   memory::store32(data, Reg::control, 0x07654321);
 }
 
 // is an interrupt active?
-bool DMA::irq_active() { return bit(data[Reg::interrupt], 31); }
+bool DMA::irq_active() {
+  return bit(memory::load32(data, Reg::interrupt), 31);
+}
 
 // logic for 31th bit in dma interrupt register
 static u8 extract_irq_active(u32 interrupt) {
@@ -327,9 +500,9 @@ static u8 extract_irq_active(u32 interrupt) {
 }
 
 void DMA::set_interrupt(u32 val) {
-  u8 irq = extract_irq_active(val);
-  u8 channels_interrupt_ack_status =
-      bits_in_range(data[Reg::interrupt], 24, 30);
+  bool was_active = irq_active();
+  u32 cur = memory::load32(data, Reg::interrupt);
+  u8 channels_interrupt_ack_status = bits_in_range(cur, 24, 30);
   u8 new_channels_interrupt_ack_status = bits_in_range(val, 24, 30);
 
   // writing 1 to ack flags resets it
@@ -337,10 +510,18 @@ void DMA::set_interrupt(u32 val) {
 
   LOG_INFO("DMA IRQ en: %s 0x%x", bit(val, 23) != 0 ? "true" : "false", val);
 
-  u8 last_byte = (irq << 7) | channels_interrupt_ack_status;
-  bits_copy_to_range(val, 24, 31, last_byte);
+  bits_copy_to_range(val, 24, 30, channels_interrupt_ack_status);
+
+  // NOTE: bit 31 follows the flags left after the ack
+  u8 active = extract_irq_active(val);
+  bit_copy_to(val, 31, active);
 
   memory::store32(data, Reg::interrupt, val);
+
+  // NOTE: the controller only sees the rising edge
+  if (active && !was_active) {
+    irq.raise(Interrupt::dma);
+  }
 }
 
 // TODO: may be needless as addr is already being masked each iteration
@@ -368,17 +549,175 @@ DMA::ChannelView DMA::make_channel_view(u32 dma_reg_index) {
   };
 }
 
-int DMA::try_transfer(ChannelView &chview) {
+void DMA::request(ChannelView &chview) {
+  const u32 channel_bit = 1U << channel_index(chview.type);
+
+  if ((busy & channel_bit) != 0) {
+    // NOTE: the data already moved, a write can only stop the channel early
+    // and then it never raises its flag
+    if (!chview::transfer_enabled(chview)) {
+      busy &= ~channel_bit;
+    }
+    return;
+  }
+
+  // NOTE: a write restarts a suspended transfer from the registers
+  suspended &= ~channel_bit;
+
+  if (chview::transfer_active(chview)) {
+    requested |= channel_bit;
+  } else {
+    requested &= ~channel_bit;
+  }
+}
+
+int DMA::arbitrate(Clock &clock) {
+  int status = 0;
+
+  // NOTE: channels only start once the bus is free, the one holding it
+  // starts the next from sync() when it completes
+  while (busy == 0) {
+    int n = next_channel(memory::load32(data, Reg::control), requested);
+    if (n < 0)
+      break;
+
+    requested &= ~(1U << n);
+
+    ChannelView channel = make_channel_view(n << 4);
+    if (try_transfer(channel, clock) < 0) {
+      LOG_ERROR("DMA on channel %d failed, dropping it", n);
+      chview::finalize_transfer(channel);
+      chview::sync(channel);
+      status = -1;
+    }
+  }
+
+  return status;
+}
+
+int DMA::try_transfer(ChannelView &chview, Clock &clock) {
+  const u32 n = channel_index(chview.type);
+  const u32 channel_bit = 1U << n;
+
+  if (!chview::transfer_active(chview))
+    return 0;
+
+  u64 cycles = 0;
+  int status = transfer(*this, chview, cycles);
+  if (status < 0)
+    return status;
+
+  // NOTE: waits count from the last sync, the transfer starts after the
+  // stall already charged since then
+  const u64 start = stalled;
+
+  // NOTE: the CPU is held off the bus for the whole transfer in one go,
+  // chopping gives it windows in between so it keeps running
+  if (!chview::chopping_enabled(chview)) {
+    clock.tick(cycles);
+    stalled += cycles;
+  }
+
+  // NOTE: only a linked list looping onto itself or a request mode transfer
+  // waiting on its port is left active
   if (chview::transfer_active(chview)) {
-    int status = transfer(*this, chview);
-    if(status < 0) return status;
     chview::sync(chview);
+    suspended |= channel_bit;
+    wait[n] = start + cycles + resume_delay;
+    return 0;
   }
 
+  // NOTE: the data already moved but the channel reads busy until the
+  // transfer would have ended, complete() finalizes it then
+  u32 control = memory::load32(chview.channel_control_addr, 0);
+  bit_clear(control, 28);
+  memory::store32(chview.channel_control_addr, 0, control);
+
+  busy |= channel_bit;
+  wait[n] = start + cycles;
+
   return 0;
 }
 
-int DMA::load32(u32 &val, u32 index) {
+void DMA::complete(u32 n) {
+  ChannelView channel = make_channel_view(n << 4);
+  chview::finalize_transfer(channel);
+  chview::sync(channel);
+
+  u32 interrupt = memory::load32(data, Reg::interrupt);
+  if (bit(interrupt, 16 + n) == 0)
+    return;
+
+  bool was_active = bit(interrupt, 31) != 0;
+  bit_set(interrupt, 24 + n);
+
+  u8 active = extract_irq_active(interrupt);
+  bit_copy_to(interrupt, 31, active);
+  memory::store32(data, Reg::interrupt, interrupt);
+
+  // NOTE: the controller only sees the rising edge
+  if (active && !was_active) {
+    irq.raise(Interrupt::dma);
+  }
+}
+
+u64 DMA::sync(u64 cycles, Clock &clock) {
+  u64 delay = Clock::never;
+  stalled = 0;
+
+  for (u32 n = 0; n < channel_count; ++n) {
+    const u32 channel_bit = 1U << n;
+    if (((busy | suspended) & channel_bit) == 0)
+      continue;
+
+    if (cycles < wait[n]) {
+      wait[n] -= cycles;
+    } else if ((busy & channel_bit) != 0) {
+      busy &= ~channel_bit;
+      complete(n);
+    } else {
+      // NOTE: competes for the bus again with the others
+      suspended &= ~channel_bit;
+      requested |= channel_bit;
+    }
+  }
+
+  // NOTE: nowhere to report failures from here, arbitrate drops them
+  arbitrate(clock);
+
+  // NOTE: the clock is already past a transfer that ended within the stall,
+  // it completes now so the next queued one starts when it really ended
+  for (u32 n = 0; n < channel_count;) {
+    const u32 channel_bit = 1U << n;
+    if ((busy & channel_bit) == 0 || wait[n] > stalled) {
+      ++n;
+      continue;
+    }
+
+    busy &= ~channel_bit;
+    complete(n);
+    arbitrate(clock);
+    n = 0;
+  }
+
+  // NOTE: the clock recorded this sync before the transfers started above
+  // stalled it, the next one counts that stall so the delay leaves it out
+  for (u32 n = 0; n < channel_count; ++n) {
+    if (((busy | suspended) & (1U << n)) == 0)
+      continue;
+
+    u64 left = wait[n] > stalled ? wait[n] - stalled : 0;
+    if (left < delay) {
+      delay = left;
+    }
+  }
+
+  return delay;
+}
+
+int DMA::load32(u32 &val, u32 index, Clock &clock) {
+  clock.sync(PCIType::dma);
+
   switch (index) {
   case DMA::Reg::control:
   case DMA::Reg::interrupt:
@@ -414,8 +753,19 @@ int DMA::load32(u32 &val, u32 index) {
   return -1;
 }
 
-int DMA::store32(u32 val, u32 index) {
+int DMA::store32(u32 val, u32 index, Clock &clock) {
+  clock.sync(PCIType::dma);
+
   switch (index) {
+  case DMA::Reg::control: {
+    memory::store32(data, index, val);
+
+    // NOTE: may enable a channel that was already requested
+    int status = arbitrate(clock);
+    clock.sync(PCIType::dma);
+    return status;
+  }
+
   case DMA::Reg::interrupt:
     set_interrupt(val);
     return 0;
@@ -439,7 +789,12 @@ int DMA::store32(u32 val, u32 index) {
   case DMA::Reg::otc_channel_control:
     memory::store32(data, index, val);
     DMA::ChannelView channel = make_channel_view(index);
-    return try_transfer(channel);
+    request(channel);
+    int status = arbitrate(clock);
+
+    // NOTE: counts the stall against the transfer and schedules its end
+    clock.sync(PCIType::dma);
+    return status;
   }
 
   memory::store32(data, index, val);
@@ -0,0 +1,101 @@
+#include "fastmem.hpp"
+#include "pci.hpp"
+#include "log.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace {
+
+static_assert(RAM::size % FastMem::page_size == 0);
+static_assert(Bios::size % FastMem::page_size == 0);
+
+void set_page_flags(FastMem &fm, Range range, PCIType type, u8 flags) {
+  flags |= flags << FastMem::Page::mapped_shift;
+  flags |= type << FastMem::Page::type_shift;
+
+  for (u32 addr = range.beg; addr < range.end; addr += FastMem::page_size) {
+    fm.page_flags[addr >> FastMem::page_shift] = flags;
+  }
+}
+
+int map_fixed(u8 *at, u32 size, int prot, int fd, u32 offset) {
+  void *addr = mmap(at, size, prot, MAP_SHARED | MAP_FIXED, fd, offset);
+  if (addr == MAP_FAILED) {
+    LOG_ERROR("Failed to map fastmem view at %p", at);
+    return -1;
+  }
+
+  return 0;
+}
+
+int mirror(FastMem &fm, const Arena &arena, const BiosImage &bios) {
+  // NOTE: aligned like the arena so RAM views can use huge pages too
+  fm.base = Arena::reserve(FastMem::space_size);
+  if (fm.base == nullptr) {
+    LOG_ERROR("Failed to reserve fastmem guest space");
+    return -1;
+  }
+
+  // RAM is mirrored 4 times in the first 8MB
+  for (u32 addr = RAM::range.beg; addr < RAM::range.end; addr += RAM::size) {
+    if (map_fixed(fm.base + addr, RAM::size, PROT_READ | PROT_WRITE, arena.fd,
+                  arena.offset(arena.ram)) < 0)
+      return -1;
+  }
+
+#ifdef MADV_HUGEPAGE
+  madvise(fm.base + RAM::range.beg, RAM::range.end - RAM::range.beg,
+          MADV_HUGEPAGE);
+#endif
+
+  u8 *bios_view = fm.base + Bios::range.beg;
+  if (map_fixed(bios_view, Bios::size, PROT_READ, bios.fd, 0) < 0)
+    return -1;
+
+  set_page_flags(fm, RAM::range, PCIType::ram,
+                 FastMem::Page::read | FastMem::Page::write);
+  set_page_flags(fm, Bios::range, PCIType::bios, FastMem::Page::read);
+
+  return 0;
+}
+
+} // namespace
+
+FastMem::~FastMem() { release(); }
+
+int FastMem::init(const Arena &arena, const BiosImage &bios) {
+  if (arena.fd < 0) {
+    LOG_WARN("Arena is not memfd backed, fastmem disabled");
+    return -1;
+  }
+
+  if (mirror(*this, arena, bios) < 0) {
+    LOG_WARN("Guest space mirroring failed, fastmem disabled");
+    release();
+    return -1;
+  }
+
+  return 0;
+}
+
+void FastMem::protect(u32 addr, u8 kinds) {
+  if (addr >= space_size)
+    return;
+
+  u8 &flags = page_flags[addr >> page_shift];
+  u8 mapped = (flags >> Page::mapped_shift) & (Page::read | Page::write);
+
+  flags &= ~(Page::read | Page::write);
+  flags |= mapped & ~kinds;
+}
+
+void FastMem::release() {
+  if (base != nullptr) {
+    munmap(base, space_size);
+    base = nullptr;
+  }
+
+  memset(page_flags, 0, sizeof(page_flags));
+}
@@ -1,8 +1,13 @@
 #include "gpu.hpp"
+#include "timers.hpp"
+#include "data.hpp"
 #include "intrinsic.hpp"
 #include "log.hpp"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
 
 static int gp0_draw_mode(GPU &gpu, const GPUcommandBuffer &buf) {
   u32 val = buf.data[0];
@@ -109,12 +114,9 @@ static int gp0_nope(GPU &gpu, const GPUcommandBuffer &buf) { return 0; }
 static int gp0_clear_cache(GPU &gpu, const GPUcommandBuffer &buf) { return 0; }
 
 static int gp0_load_image(GPU &gpu, const GPUcommandBuffer &buf) {
-  u32 resolution = buf.data[2];
-
-  u32 width = resolution & 0xffff;
-  u32 height = resolution >> 16;
+  gpu.vram_load = vram_transfer_from_gp0(buf.data[1], buf.data[2]);
 
-  u32 img_size = width * height;
+  u32 img_size = gpu.vram_load.width * gpu.vram_load.height;
 
   // NOTE: round up if odd, gpu uses 16bits aligned
   img_size = (img_size + 1) & (~1);
@@ -128,13 +130,8 @@ static int gp0_load_image(GPU &gpu, const GPUcommandBuffer &buf) {
 }
 
 static int gp0_store_image(GPU &gpu, const GPUcommandBuffer &buf) {
-  u32 resolution = buf.data[2];
-
-  u32 width = resolution & 0xffff;
-  u32 height = resolution >> 16;
-
-  LOG_WARN("Unhandled image store: %dx%d", width, height);
-  // TODO: doesn't return an error
+  // NOTE: the pixels are read back through GPUREAD or DMA, see store_words
+  gpu.vram_store = vram_transfer_from_gp0(buf.data[1], buf.data[2]);
   return 0;
 }
 
@@ -192,72 +189,80 @@ int gp0_quad_texture_blend_opaque(GPU &gpu, const GPUcommandBuffer &buf) {
   return gpu.renderer->put_quad(positions, colors);
 }
 
-int GPU::gp0(u32 val) {
-  u32 opcode = bits_in_range(val, 24, 31);
+/// Number of words and handler of a GP0 command, -1 if it is unhandled
+static int gp0_decode(u32 opcode, u32 &len, GPU::GPUcommand &cmd) {
+  switch (opcode) {
+  case 0x00:
+    len = 1;
+    cmd = gp0_nope;
+    break;
+  case 0x01:
+    len = 1;
+    cmd = gp0_clear_cache;
+    break;
+  case 0x28:
+    len = 5;
+    cmd = gp0_quad_mono_opaque;
+    break;
+  case 0x2c:
+    len = 9;
+    cmd = gp0_quad_texture_blend_opaque;
+    break;
+  case 0x30:
+    len = 6;
+    cmd = gp0_triangle_shaded_opaque;
+    break;
+  case 0x38:
+    len = 8;
+    cmd = gp0_quad_shaded_opaque;
+    break;
+  case 0xa0:
+    len = 3;
+    cmd = gp0_load_image;
+    break;
+  case 0xc0:
+    len = 3;
+    cmd = gp0_store_image;
+    break;
+  case 0xe1:
+    len = 1;
+    cmd = gp0_draw_mode;
+    break;
+  case 0xe2:
+    len = 1;
+    cmd = gp0_texture_window;
+    break;
+  case 0xe3:
+    len = 1;
+    cmd = gp0_drawing_area_top_left;
+    break;
+  case 0xe4:
+    len = 1;
+    cmd = gp0_drawing_area_bottom_right;
+    break;
+  case 0xe5:
+    len = 1;
+    cmd = gp0_drawing_offset;
+    break;
+  case 0xe6:
+    len = 1;
+    cmd = gp0_mask_bit_setting;
+    break;
 
-  if (gp0_cmd_pending_words_count == 0) {
+  default:
+    return -1;
+  }
 
-    clear(gp0_cmd_buf);
 
-    switch (opcode) {
-    case 0x00:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_nope;
-      break;
-    case 0x01:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_clear_cache;
-      break;
-    case 0x28:
-      gp0_cmd_pending_words_count = 5;
-      gp0_cmd = gp0_quad_mono_opaque;
-      break;
-    case 0x2c:
-      gp0_cmd_pending_words_count = 9;
-      gp0_cmd = gp0_quad_texture_blend_opaque;
-      break;
-    case 0x30:
-      gp0_cmd_pending_words_count = 6;
-      gp0_cmd = gp0_triangle_shaded_opaque;
-      break;
-    case 0x38:
-      gp0_cmd_pending_words_count = 8;
-      gp0_cmd = gp0_quad_shaded_opaque;
-      break;
-    case 0xa0:
-      gp0_cmd_pending_words_count = 3;
-      gp0_cmd = gp0_load_image;
-      break;
-    case 0xc0:
-      gp0_cmd_pending_words_count = 3;
-      gp0_cmd = gp0_store_image;
-      break;
-    case 0xe1:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_draw_mode;
-      break;
-    case 0xe2:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_texture_window;
-      break;
-    case 0xe3:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_drawing_area_top_left;
-      break;
-    case 0xe4:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_drawing_area_bottom_right;
-      break;
-    case 0xe5:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_drawing_offset;
-      break;
-    case 0xe6:
-      gp0_cmd_pending_words_count = 1;
-      gp0_cmd = gp0_mask_bit_setting;
-      break;
+  return 0;
+}
 
-    default:
+int GPU::gp0(u32 val) {
+  if (gp0_cmd_pending_words_count == 0) {
+    clear(gp0_cmd_buf);
+
+    if (gp0_decode(bits_in_range(val, 24, 31), gp0_cmd_pending_words_count,
+                   gp0_cmd) < 0) {
       LOG_ERROR("Unhandled GP0 command 0x%x", val);
       return -1;
     }
@@ -271,7 +276,7 @@ int GPU::gp0(u32 val) {
       return gp0_cmd(*this, gp0_cmd_buf);
     }
   } else {
-    // TODO: should copy pixel data to vram
+    load_words(&val, 1);
     if (gp0_cmd_pending_words_count == 0) {
       // load done
       gp0_mode = GP0mode::command;
@@ -281,6 +286,64 @@ int GPU::gp0(u32 val) {
   return 0;
 }
 
+int GPU::gp0_batch(const u32 *words, size_t n) {
+  size_t i = 0;
+
+  while (i < n) {
+    if (gp0_cmd_pending_words_count != 0) {
+      if (gp0_mode == GP0mode::img_load) {
+        // NOTE: straight from the span, which is guest RAM under DMA
+        size_t take = std::min<size_t>(gp0_cmd_pending_words_count, n - i);
+        load_words(words + i, take);
+        gp0_cmd_pending_words_count -= take;
+        i += take;
+
+        if (gp0_cmd_pending_words_count == 0) {
+          gp0_mode = GP0mode::command;
+        }
+        continue;
+      }
+
+      // NOTE: finish a command split across batches word by word
+      int status = gp0(words[i++]);
+      if (status < 0)
+        return status;
+      continue;
+    }
+
+    u32 len;
+    if (gp0_decode(bits_in_range(words[i], 24, 31), len, gp0_cmd) < 0) {
+      LOG_ERROR("Unhandled GP0 command 0x%x", words[i]);
+      return -1;
+    }
+
+    if (n - i < len) {
+      // NOTE: the rest comes with the next batch
+      clear(gp0_cmd_buf);
+      gp0_cmd_pending_words_count = len;
+
+      while (i < n) {
+        int status = gp0(words[i++]);
+        if (status < 0)
+          return status;
+      }
+      break;
+    }
+
+    // NOTE: whole command available, run it without going through the
+    // per-word state machine
+    memcpy(gp0_cmd_buf.data, words + i, len * sizeof(u32));
+    gp0_cmd_buf.count = len;
+    i += len;
+
+    int status = gp0_cmd(*this, gp0_cmd_buf);
+    if (status < 0)
+      return status;
+  }
+
+  return 0;
+}
+
 int gp1_dma_direction(GPU &gpu, u32 val) {
   switch (bits_in_range(val, 0, 1)) {
   case 0:
@@ -334,7 +397,8 @@ int gp1_display_mode(GPU &gpu, u32 val, Clock &clock) {
     return -1;
   }
 
-  gpu.clock_sync(clock);
+  gpu.update_timings();
+  clock.sync(PCIType::gpu);
 
   return 0;
 }
@@ -355,7 +419,7 @@ int gp1_display_horizontal_range(GPU &gpu, u32 val) {
 int gp1_display_vertical_range(GPU &gpu, u32 val, Clock &clock) {
   gpu.display_line_start = bits_in_range(val, 0, 9);
   gpu.display_line_end = bits_in_range(val, 10, 19);
-  gpu.clock_sync(clock);
+  clock.sync(PCIType::gpu);
   return 0;
 }
 
@@ -424,7 +488,8 @@ int gp1_soft_reset(GPU &gpu, u32 val, Clock &clock) {
   gp1_reset_command_buffer(gpu, 0);
   gp1_ack_irq(gpu, 0);
 
-  gpu.clock_sync(clock);
+  gpu.update_timings();
+  clock.sync(PCIType::gpu);
 
   // TODO: should also clear the command FIFO
   // TODO: should also invalidate GPU cache
@@ -485,12 +550,12 @@ u32 GPU::status() {
   val |= static_cast<u32>(display_disabled) << 23;
   val |= static_cast<u32>(gp0_interrupt) << 24;
 
-  // REVIEW: we pretend GPU is always ready
+  // REVIEW: we pretend GPU is always ready to receive
 
   // NOTE: ready to receive command
   val |= 1 << 26;
-  // NOTE: ready to send VRAM to CPU
-  val |= 1 << 27;
+  // NOTE: ready to send VRAM to CPU while an image store has words left
+  val |= static_cast<u32>(!vram_store.done()) << 27;
   // NOTE: ready to receive dma block
   val |= 1 << 28;
 
@@ -524,13 +589,99 @@ u32 GPU::status() {
   return val;
 }
 
+void GPU::load_words(const u32 *words, size_t n) {
+  VRAMTransfer &t = vram_load;
+  const u16 set_mask = force_set_mask_bit ? 0x8000 : 0;
+  const bool plain = set_mask == 0 && !preserve_masked_pixels;
+
+  // NOTE: p counts pixels, the low half of a word comes first
+  size_t p = 0;
+  const size_t count = n * 2;
+
+  while (p < count && !t.done()) {
+    u16 *line = vram.data + ((t.y + t.row) & (VRAM::height - 1)) * VRAM::width;
+    size_t run = std::min<size_t>(t.width - t.col, count - p);
+    u32 x = (t.x + t.col) & (VRAM::width - 1);
+
+    if (plain && x + run <= VRAM::width) {
+      // NOTE: the usual texture upload, copied a row at a time. Guest and
+      // host are both little endian so the halfwords are already in order.
+      memcpy(line + x, reinterpret_cast<const u8 *>(words) + p * sizeof(u16),
+             run * sizeof(u16));
+    } else {
+      // NOTE: x wraps within the line
+      for (size_t i = 0; i < run; ++i) {
+        u16 &pixel = line[(x + i) & (VRAM::width - 1)];
+        if (preserve_masked_pixels && (pixel & 0x8000) != 0)
+          continue;
+
+        u32 word = words[(p + i) >> 1];
+        pixel = static_cast<u16>(word >> (((p + i) & 1) * 16)) | set_mask;
+      }
+    }
+
+    p += run;
+    t.col += run;
+
+    if (t.col == t.width) {
+      t.col = 0;
+      ++t.row;
+    }
+  }
+}
+
+void GPU::store_words(u32 *words, size_t n) {
+  VRAMTransfer &t = vram_store;
+
+  // NOTE: written as bytes, p counts pixels and the low half of a word
+  // comes first. Guest and host are both little endian.
+  u8 *bytes = reinterpret_cast<u8 *>(words);
+  size_t p = 0;
+  const size_t count = n * 2;
+
+  while (p < count && !t.done()) {
+    const u16 *line =
+        vram.data + ((t.y + t.row) & (VRAM::height - 1)) * VRAM::width;
+    size_t run = std::min<size_t>(t.width - t.col, count - p);
+    u32 x = (t.x + t.col) & (VRAM::width - 1);
+
+    if (x + run <= VRAM::width) {
+      memcpy(bytes + p * sizeof(u16), line + x, run * sizeof(u16));
+    } else {
+      // NOTE: x wraps within the line
+      for (size_t i = 0; i < run; ++i) {
+        memory::store16(bytes, (p + i) * sizeof(u16),
+                        line[(x + i) & (VRAM::width - 1)]);
+      }
+    }
+
+    p += run;
+    t.col += run;
+
+    if (t.col == t.width) {
+      t.col = 0;
+      ++t.row;
+    }
+  }
+
+  memset(bytes + p * sizeof(u16), 0, (count - p) * sizeof(u16));
+
+  if (n > 0) {
+    read_latch = memory::load32(bytes, (n - 1) * sizeof(u32));
+  }
+}
+
 u32 GPU::read() {
-  LOG_WARN("GPUREAD");
-  return 0;
+  if (!vram_store.done()) {
+    u32 val = 0;
+    store_words(&val, 1);
+  }
+
+  return read_latch;
 }
 
 int GPU::load32(u32 &val, u32 index, Clock &clock) {
-  clock_sync(clock);
+  clock.sync(PCIType::gpu);
 
   switch (index) {
   case 0:
@@ -547,7 +698,7 @@ int GPU::load32(u32 &val, u32 index, Clock &clock) {
 }
 
 int GPU::store32(u32 val, u32 index, Clock &clock) {
-  clock_sync(clock);
+  clock.sync(PCIType::gpu);
   
   switch (index) {
   case 0:
@@ -578,35 +729,22 @@ void GPU::vmode_timings(u16 &horizontal, u16 &vertical) {
   vertical = 314;
 }
 
-u64 GPU::gpu_to_cpu_clock_ratio() {
-  static constexpr f32 cpu_clock = 33.8685f;
-  // TODO: can be constexpr
-  f32 gpu_clock;
+void GPU::update_timings() {
+  u64 gpu_hz = clock_hz();
 
-  if (configured_hardware_video_mode == VideoMode::ntsc) {
-    gpu_clock = 53.69f;
-  } else {
-    gpu_clock = 53.20f;
-  }
+  vmode_timings(line_ticks, frame_lines);
 
-  // Clock ratio shifted 16bits to the left
-  return ((gpu_clock / cpu_clock) * static_cast<f32>(clock_ratio_frac));
+  // NOTE: these drop their carried remainder, that's less than a line or a
+  // dot. Timers keep theirs when the ratio didn't change.
+  hblank = ClockDomain::from_hz(gpu_hz, line_ticks);
+  dot_clock = ClockDomain::from_hz(gpu_hz, dot_divider());
 }
 
-void GPU::clock_sync(Clock &clock) {
-  u64 delta = clock.sync(PCIType::gpu);
-
-  delta = static_cast<u64>(gpu_clock_frac) + (delta * gpu_to_cpu_clock_ratio());
-
-  gpu_clock_frac = delta;
+u64 GPU::sync(u64 cycles, Clock &clock) {
+  u64 delta = video_clock.advance(cycles);
 
-  delta >>= 16;
-
-  // REVIEW: casting
-  u16 h, v;
-  vmode_timings(h, v);
-  u64 horiz = h;
-  u64 vert = v;
+  u64 horiz = line_ticks;
+  u64 vert = frame_lines;
 
   u64 line_tick = display_line_tick + delta;
   u64 line = display_line + (line_tick / horiz);
@@ -633,9 +771,9 @@ void GPU::clock_sync(Clock &clock) {
 
   bool next_vblank_interrupt = in_vblank();
   if(!vblank_interrupt && next_vblank_interrupt) {
-    // Rising edge of the vblank interupt, should trigger an interrupt in the
-    // controller
-    LOG_INFO("GPU interrupt");
+    // Rising edge of the vblank interupt
+    irq.raise(Interrupt::vblank);
+    ++frame_count;
   }
 
   if(vblank_interrupt && !next_vblank_interrupt) {
@@ -646,20 +784,26 @@ void GPU::clock_sync(Clock &clock) {
 
   vblank_interrupt = next_vblank_interrupt;
 
-  predict_next_clock_sync(clock);
+  if (timers != nullptr) {
+    timers->blank(in_hblank(), next_vblank_interrupt, clock);
+  }
+
+  return next_sync_delay();
 }
 
-bool GPU::in_vblank() {
+bool GPU::in_vblank() const {
   return (display_line < display_line_start) ||
          (display_line >= display_line_end);
 }
 
-void GPU::predict_next_clock_sync(Clock &clock) {
-  // REVIEW: casting
-  u16 h, v;
-  vmode_timings(h, v);
-  u64 horiz = h;
-  u64 vert = v;
+bool GPU::in_hblank() const {
+  return (display_line_tick < display_horiz_start) ||
+         (display_line_tick >= display_horiz_end);
+}
+
+u64 GPU::next_sync_delay() {
+  u64 horiz = line_ticks;
+  u64 vert = frame_lines;
 
   u64 delta = 0;
 
@@ -686,18 +830,27 @@ void GPU::predict_next_clock_sync(Clock &clock) {
     delta += (display_line_end - 1 - display_line) * horiz;
   }
 
-  // Convert delta in CPU clock periods
-  delta *= clock_ratio_frac;
-
-  // remove the current fractional cycle to be more accurate
-  delta -= gpu_clock_frac;
+  // NOTE: timer 0 needs both edges of every line, only then the GPU syncs
+  // more often than twice a frame
+  if (timers != nullptr && timers->wants_hblank()) {
+    u64 tick = display_line_tick;
+    u64 hblank_delta;
+
+    if (tick < display_horiz_start) {
+      hblank_delta = display_horiz_start - tick;
+    } else if (tick < display_horiz_end) {
+      hblank_delta = display_horiz_end - tick;
+    } else {
+      hblank_delta = horiz - tick + display_horiz_start;
+    }
 
-  // divide by the ratio while always rounding up to make sure we're never
-  // triggered too early
-  u64 ratio = gpu_to_cpu_clock_ratio();
-  delta = (delta + ratio - 1) / ratio;
+    if (hblank_delta < delta) {
+      delta = hblank_delta;
+    }
+  }
 
-  clock.set_alarm_after(PCIType::gpu, delta);
+  // NOTE: rounded up so we're never triggered too early
+  return video_clock.cpu_cycles_until(delta);
 }
 
 u16 GPU::displayed_vram_line() {
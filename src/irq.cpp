@@ -0,0 +1,34 @@
+#include "irq.hpp"
+#include "log.hpp"
+
+int IRQ::load(u32 &val, u32 index) {
+  switch (index) {
+  case Reg::status:
+    val = status;
+    return 0;
+  case Reg::mask:
+    val = mask;
+    return 0;
+  }
+
+  // NOTE: upper halves of 16bit accesses
+  val = 0;
+  return 0;
+}
+
+int IRQ::store(u32 val, u32 index) {
+  switch (index) {
+  case Reg::status:
+    // NOTE: writing 0 acknowledges, writing 1 leaves the bit unchanged
+    status &= val;
+    break;
+  case Reg::mask:
+    mask = val & lines;
+    break;
+  default:
+    return 0;
+  }
+
+  update();
+  return 0;
+}
@@ -2,6 +2,7 @@
 #include "cpu.hpp"
 #include "data.hpp"
 #include "renderer.hpp"
+#include "pacer.hpp"
 
 #include <SDL_events.h>
 #include <iostream>
@@ -11,8 +12,8 @@ int main() {
   // TODO: handle fixed path
   static constexpr const char *bios_path = "res/bios/SCPH1001.BIN";
 
-  Bios bios;
-  if (file::read_file(bios.data, bios_path, Bios::size)) {
+  BiosImage bios;
+  if (bios.load(bios_path) < 0) {
     return -1;
   }
 
@@ -27,21 +28,55 @@ int main() {
     return -1;
   }
 
-  PCI pci(std::move(bios), &renderer, VideoMode::ntsc);
+  PCI pci(bios, &renderer, VideoMode::ntsc);
+  if (pci.arena.data == nullptr) {
+    return -1;
+  }
+
   CPU cpu = CPU(pci);
+  FramePacer pacer;
 
   int status = 0;
   while(!status) {
-    for(int i = 0; i < 1000000 && !status; ++i) {
+    // NOTE: runs one emulated frame, vblank always comes even with the
+    // display disabled. The cycle budget still gets back to the events and
+    // the pacer if it doesn't, a few frames at the slowest refresh rate
+    static constexpr u64 frame_budget = ClockRate::cpu / 50 * 4;
+
+    u64 frame = pci.gpu.frame_count;
+    u64 budget_end = cpu.clock.now + frame_budget;
+    while (pci.gpu.frame_count == frame && cpu.clock.now < budget_end &&
+           !status) {
       status = cpu.next();
     }
 
+    pacer.end_frame(pci.gpu);
+
     SDL_Event event;
     while(SDL_PollEvent(&event)) {
       switch(event.type) {
       case SDL_KEYDOWN:
-        if (event.key.keysym.sym == SDLK_ESCAPE) {
+        switch (event.key.keysym.sym) {
+        case SDLK_ESCAPE:
           status = 1;
+          break;
+        case SDLK_TAB:
+          // NOTE: held down
+          if (pacer.mode == FramePacer::Mode::normal) {
+            pacer.mode = FramePacer::Mode::fast_forward;
+          }
+          break;
+        case SDLK_u:
+          pacer.mode = pacer.mode == FramePacer::Mode::uncapped
+                           ? FramePacer::Mode::normal
+                           : FramePacer::Mode::uncapped;
+          break;
+        }
+        break;
+      case SDL_KEYUP:
+        if (event.key.keysym.sym == SDLK_TAB &&
+            pacer.mode == FramePacer::Mode::fast_forward) {
+          pacer.mode = FramePacer::Mode::normal;
         }
         break;
       case SDL_QUIT:
@@ -51,6 +86,8 @@ int main() {
     }
   }
 
+  LOG_INFO("Emulated memory resident: %lu KB", pci.arena.resident() / 1024);
+
   renderer.clean_buffers();
   renderer.clean_program_and_shaders();
 
@@ -0,0 +1,41 @@
+#include "pacer.hpp"
+
+#include <thread>
+
+FramePacer::HostClock::duration
+FramePacer::frame_period(const GPU &gpu) const {
+  u64 ticks = u64{gpu.line_ticks} * gpu.frame_lines;
+  u64 ns = ticks * 1000000000 / gpu.clock_hz();
+
+  if (mode == Mode::fast_forward && speed_factor > 1) {
+    ns /= speed_factor;
+  }
+
+  return std::chrono::duration_cast<HostClock::duration>(
+      std::chrono::nanoseconds(ns));
+}
+
+void FramePacer::end_frame(const GPU &gpu) {
+  if (mode == Mode::uncapped) {
+    started = false;
+    return;
+  }
+
+  HostClock::duration period = frame_period(gpu);
+  HostClock::time_point now = HostClock::now();
+
+  if (!started || now - deadline > period * max_lag_frames) {
+    deadline = now;
+    started = true;
+  }
+
+  deadline += period;
+
+  HostClock::duration remaining = deadline - now;
+  if (remaining > spin_threshold) {
+    std::this_thread::sleep_for(remaining - spin_threshold);
+  }
+
+  while (HostClock::now() < deadline) {
+  }
+}
@@ -1,488 +1,220 @@
 #include "pci.hpp"
 #include "data.hpp"
 #include "log.hpp"
+#include "bits.hpp"
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 
-void PCI::clock_sync(Clock &clock) {
-  if(clock.alarmed(PCIType::gpu)) {
-    gpu.clock_sync(clock);
-  }
-}
-
-static u32 mask_addr_to_region(u32 addr) {
-  static const u32 region_mask[8] = {// KUSEG: 2048MB
-                                     0xffffffff, 0xffffffff, 0xffffffff,
-                                     0xffffffff,
-                                     // KSEG0: 512MB
-                                     0x7fffffff,
-                                     // KSEG1: 512MB
-                                     0x1fffffff,
-                                     // KSEG2: 1024MB
-                                     0xffffffff, 0xffffffff};
-
-  return addr & region_mask[addr >> 29];
-}
-
-
-int ignore_load_with(u32 &val, const char *fn, u32 addr, u32 index,
-                               const char *msg, u32 with) {
-  LOG_DEBUG("[FN:%s ADDR:0x%08x IND:%d] Ignored %s", fn, addr, index, msg);
-  val = with;
-  return 0;
-}
-
-template <typename StoreType>
-constexpr int ignore_store(StoreType val, const char *fn, u32 addr, u32 index,
-                           const char *msg) {
-  LOG_DEBUG("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] Ignored %s", fn, addr, index,
-            val, msg);
-  return 0;
-}
-
-int PCI::load32(u32 &val, u32 addr, Clock &clock) {
-  static const char *fn = "PCI::load32";
-  u32 index;
-
-  addr = mask_addr_to_region(addr);
-
-  if (!Bios::range.offset(index, addr)) {
-    val = memory::load32(bios.data, index);
-    return 0;
-  }
-
-  if (!HWregs::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "HWregs");
-    return -1;
-  }
-
-  if (!RamSize::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "RamSize");
-    return -1;
-  }
-
-  if (!CacheCtrl::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "CacheCtrl");
-    return -1;
-  }
+PCI::PCI(const BiosImage &bios_image, Renderer *renderer,
+         VideoMode configured_hardware_video_mode, bool fastmem_enabled)
+    : gpu(renderer, irq, configured_hardware_video_mode), timers(gpu, irq),
+      dma(ram, gpu, irq) {
+  if (arena.init() < 0)
+    return;
 
-  if (!RAM::range.offset(index, addr)) {
-    val = memory::load32(ram.data, index);
-    return 0;
+  if (fastmem_enabled) {
+    fastmem.init(arena, bios_image);
   }
 
-  if (!SPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "SPU");
-    return -1;
-  }
+  ram.data = arena.ram;
+  bios.data = bios_image.data;
+  scratchpad.data = arena.scratchpad;
+  spu.data = arena.spu;
+  gpu.vram.data = reinterpret_cast<u16 *>(arena.vram);
+  dma.init(arena.dma);
 
-  if (!Expansion1::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Expansion1");
-    return -1;
-  }
+  // NOTE: RAM is left zeroed instead of filled with garbage so its pages are
+  // only committed when touched. BIOS clears it anyway.
+}
 
-  if (!Expansion2::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Expansion2");
-    return -1;
-  }
+void PCI::init_events(Clock &clock) {
+  irq.clock = &clock;
+  gpu.timers = &timers;
 
-  if (!IRQ::range.offset(index, addr)) {
-    return ignore_load_with(val, fn, addr, index, "IRQ", 0);
-  }
+  clock.attach(PCIType::gpu, gpu);
+  clock.attach(PCIType::timers, timers);
+  clock.attach(PCIType::dma, dma);
 
-  if (!Timers::range.offset(index, addr)) {
-    return ignore_load_with(val, fn, addr, index, "Timers", 0);
-  }
-  
-  if (!DMA::range.offset(index, addr)) {
-    return dma.load32(val, index);
-  }
-
-  if (!GPU::range.offset(index, addr)) {
-    return gpu.load32(val, index, clock);
-  }
+  // NOTE: first sync right away, it predicts the next one
+  clock.schedule(PCIType::gpu, 0);
+}
 
-  LOG_ERROR("[FN:%s ADDR:0x%08x] Unhandled", fn, addr);
-  return -1;
+HWregs::HWregs() {
+  // NOTE: power on values, BIOS writes the same ones early on
+  memory::store32(data, Reg::expansion1_base, 0x1f000000);
+  memory::store32(data, Reg::expansion2_base, 0x1f802000);
+  memory::store32(data, Reg::expansion1_delay, 0x0013243f);
+  memory::store32(data, Reg::expansion3_delay, 0x00003022);
+  memory::store32(data, Reg::bios_delay, 0x0013243f);
+  memory::store32(data, Reg::spu_delay, 0x200931e1);
+  memory::store32(data, Reg::cdrom_delay, 0x00020843);
+  memory::store32(data, Reg::expansion2_delay, 0x00070777);
+  memory::store32(data, Reg::com_delay, 0x00031125);
+
+  decode_timings();
 }
 
-int PCI::load16(u32 &val, u32 addr) {
-  static const char *fn = "PCI::load16";
-  u32 index;
+// NOTE: see nocash "Memory Control". Delay registers select which of the COM
+// delays take part in an access on top of their own access time. Narrow
+// buses split wider accesses into sequential ones.
+static void decode_timing(u8 cost[3], u32 delay, u32 com_delay) {
+  i32 access_time = bits_in_range(delay, 4, 7);
+  i32 com0 = bits_in_range(com_delay, 0, 3);
+  i32 com2 = bits_in_range(com_delay, 8, 11);
+  i32 com3 = bits_in_range(com_delay, 12, 15);
+  bool bus_16bit = bit(delay, 12) != 0;
 
-  addr = mask_addr_to_region(addr);
+  i32 first = 0;
+  i32 seq = 0;
+  i32 min = 0;
 
-  if (!Bios::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Bios");
-    return -1;
+  if (bit(delay, 8) != 0) {
+    first += com0 - 1;
+    seq += com0 - 1;
   }
 
-  if (!HWregs::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "HWregs");
-    return -1;
+  if (bit(delay, 10) != 0) {
+    first += com2;
+    seq += com2;
   }
 
-  if (!RamSize::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "RamSize");
-    return -1;
+  if (bit(delay, 11) != 0) {
+    min = com3;
   }
 
-  if (!CacheCtrl::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "CacheCtrl");
-    return -1;
+  if (first < 6) {
+    ++first;
   }
 
-  if (!RAM::range.offset(index, addr)) {
-    val = memory::load16(ram.data, index);
-    return 0;
-  }
+  first += access_time + 2;
+  seq += access_time + 2;
 
-  if (!SPU::range.offset(index, addr)) {
-    return ignore_load_with(val, fn, addr, index, "SPU", 0);
+  if (first < min + 6) {
+    first = min + 6;
   }
 
-  if (!Expansion1::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Expansion1");
-    return -1;
+  if (seq < min + 2) {
+    seq = min + 2;
   }
 
-  if (!Expansion2::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Expansion2");
-    return -1;
-  }
-
-  if (!IRQ::range.offset(index, addr)) {
-    return ignore_load_with(val, fn, addr, index, "IRQ", 0);
-  }
+  i32 byte = first;
+  i32 half = bus_16bit ? first : first + seq;
+  i32 word = bus_16bit ? first + seq : first + seq * 3;
 
-  if (!Timers::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Timers");
-    return -1;
-  }
+  // NOTE: the CPU already spends a cycle on the access
+  cost[bus_width_index<u8>()] = byte > 0 ? byte - 1 : 0;
+  cost[bus_width_index<u16>()] = half > 0 ? half - 1 : 0;
+  cost[bus_width_index<u32>()] = word > 0 ? word - 1 : 0;
+}
 
-  if (!DMA::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "DMA");
-    return -1;
-  }
+void HWregs::decode_timings() {
+  u32 com_delay = memory::load32(data, Reg::com_delay);
+
+  decode_timing(access_cost[PCIType::expansion1],
+                memory::load32(data, Reg::expansion1_delay), com_delay);
+  decode_timing(access_cost[PCIType::bios],
+                memory::load32(data, Reg::bios_delay), com_delay);
+  decode_timing(access_cost[PCIType::spu],
+                memory::load32(data, Reg::spu_delay), com_delay);
+  decode_timing(access_cost[PCIType::expansion2],
+                memory::load32(data, Reg::expansion2_delay), com_delay);
+}
 
-  if (!GPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "GPU");
-    return -1;
+int bus::unhandled(BusOp op, u32 width, u32 addr, u32 val,
+                   const char *what) {
+  if (op == BusOp::load) {
+    LOG_ERROR("[FN:PCI::load%d ADDR:0x%08x] %s", width, addr, what);
+  } else {
+    LOG_ERROR("[FN:PCI::store%d ADDR:0x%08x VAL:0x%08x] %s", width, addr, val,
+              what);
   }
-
-  LOG_ERROR("[FN:%s ADDR:0x%08x] Unhandled", fn, addr);
   return -1;
 }
 
-int PCI::load8(u32 &val, u32 addr) {
-  static const char *fn = "PCI::load8";
-  u32 index;
-
-  addr = mask_addr_to_region(addr);
-
-  if (!Bios::range.offset(index, addr)) {
-    val = memory::load8(bios.data, index);
-    return 0;
-  }
-
-  if (!HWregs::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "HWregs");
-    return -1;
-  }
-
-  if (!RamSize::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "RamSize");
-    return -1;
-  }
-
-  if (!CacheCtrl::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "CacheCtrl");
-    return -1;
+// NOTE: width and addr only go to LOG_DEBUG, which may compile out
+int bus::ignored(BusOp op, [[maybe_unused]] u32 width,
+                 [[maybe_unused]] u32 addr, u32 &val, const BusRegion &region) {
+  if (op == BusOp::load) {
+    LOG_DEBUG("[FN:PCI::load%d ADDR:0x%08x] Ignored %s", width, addr,
+              region.name);
+    val = region.ignore_val;
+  } else {
+    LOG_DEBUG("[FN:PCI::store%d ADDR:0x%08x VAL:0x%08x] Ignored %s", width,
+              addr, val, region.name);
   }
 
-  if (!RAM::range.offset(index, addr)) {
-    val = memory::load8(ram.data, index);
-    return 0;
-  }
-
-  if (!SPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "SPU");
-    return -1;
-  }
-
-  if (!Expansion1::range.offset(index, addr)) {
-    return ignore_load_with(val, fn, addr, index, "Expansion1", 0xff);
-  }
-
-  if (!Expansion2::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Expansion2");
-    return -1;
-  }
-
-  if (!IRQ::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "IRQ");
-    return -1;
-  }
-
-  if (!Timers::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "Timers");
-    return -1;
-  }
-
-  if (!DMA::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "DMA");
-    return -1;
-  }
+  return 0;
+}
 
-  if (!GPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d] %s", fn, addr, index, "GPU");
-    return -1;
+static void protect_watched(FastMem &fastmem, const Watchpoints &watchpoints,
+                            u32 addr, u32 len) {
+  for (u32 page = addr >> FastMem::page_shift;
+       page <= (addr + len - 1) >> FastMem::page_shift; ++page) {
+    u32 page_addr = page << FastMem::page_shift;
+    fastmem.protect(page_addr,
+                    watchpoints.kinds_in_page(page_addr, FastMem::page_shift));
   }
-
-  LOG_ERROR("[FN:%s ADDR:0x%08x] Unhandled", fn, addr);
-  return -1;
 }
 
-int PCI::store32(u32 val, u32 addr, Clock &clock) {
-  static const char *fn = "PCI::store32";
-  u32 index;
-  
-  addr = mask_addr_to_region(addr);
+int PCI::watch(u32 addr, u32 len, u8 kinds) {
+  addr = bus::mask_addr_to_region(addr);
 
-  if (!Bios::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Bios");
-    return -1;
-  }
+  int status = watchpoints.add(addr, len, kinds);
+  if (status < 0)
+    return status;
 
-  if (!HWregs::range.offset(index, addr)) {
-    return hw_regs.store32(val, index);
-  }
+  protect_watched(fastmem, watchpoints, addr, len);
+  return 0;
+}
 
-  if (!RamSize::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "RamSize");
-  }
+int PCI::unwatch(u32 addr) {
+  addr = bus::mask_addr_to_region(addr);
 
-  if (!CacheCtrl::range.offset(index, addr)) {
-    cache_ctrl.val = val;
-    return 0;
-  }
+  for (u32 i = 0; i < watchpoints.count; ++i) {
+    const Watchpoint wp = watchpoints.list[i];
+    if (wp.addr != addr)
+      continue;
 
-  if (!RAM::range.offset(index, addr)) {
-    memory::store32(ram.data, index, val);
+    watchpoints.remove(addr);
+    protect_watched(fastmem, watchpoints, wp.addr, wp.len);
     return 0;
   }
 
-  if (!SPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "SPU");
-    return -1;
-  }
-
-  if (!Expansion1::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Expansion1");
-    return -1;
-  }
-
-  // TODO: Rustation ignores store32 to expansion2
-  if (!Expansion2::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Expansion2");
-    return -1;
-  }
-
-  if (!IRQ::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "IRQ");
-  }
-
-  if (!Timers::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "Timers");
-  }
-  
-  if (!DMA::range.offset(index, addr)) {
-    return dma.store32(val, index);
-  }
-
-  if (!GPU::range.offset(index, addr)) {
-    return gpu.store32(val, index, clock);
-  }
-
-  LOG_ERROR("[FN:%s ADDR:0x%08x VAL:0x%08x] Unhandled", fn, addr, val);
+  LOG_ERROR("No watchpoint at 0x%08x", addr);
   return -1;
 }
 
-int PCI::store16(u16 val, u32 addr) {
-  static const char *fn = "PCI::store16";
-  u32 index;
-  
-  addr = mask_addr_to_region(addr);
-
-  if (!Bios::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Bios");
-    return -1;
-  }
-
-  if (!HWregs::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "HWregs");
-    return -1;
-  }
-
-  if (!RamSize::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "RamSize");
-    return -1;
-  }
-
-  if (!CacheCtrl::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "CacheCtrl");
-    return -1;
-  }
-
-  if (!RAM::range.offset(index, addr)) {
-    memory::store16(ram.data, index, val);
-    return 0;
-  }
-
-  if (!SPU::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "SPU");
-  }
-
-  if (!Expansion1::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Expansion1");
-    return -1;
-  }
-
-  if (!Expansion2::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Expansion2");
-    return -1;
-  }
-
-  if (!IRQ::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "IRQ");
-  }
-
-  if (!Timers::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "Timers");
-  }
-  
-  if (!DMA::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "DMA");
-    return -1;
-  }
-
-  if (!GPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "GPU");
-    return -1;
-  }
-
-  LOG_ERROR("[FN:%s ADDR:0x%08x VAL:0x%08x] Unhandled", fn, addr, val);
-  return -1;
+[[gnu::cold, gnu::noinline]] static void
+unhandled_instruction(PCI &pci, Instruction &ins, u32 addr) {
+  LOG_ERROR("[FN:PCI::load_instruction ADDR:0x%08x] Unhandled", addr);
+  ins.data = 0; // nop
+  pci.fault = true;
 }
 
-int PCI::store8(u8 val, u32 addr) {
-  static const char *fn = "PCI::store8";
+void PCI::load_instruction(Instruction &ins, u32 addr, Clock &clock) {
   u32 index;
 
-  addr = mask_addr_to_region(addr);
-
-  if (!Bios::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Bios");
-    return -1;
-  }
-
-  if (!HWregs::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "HWregs");
-    return -1;
-  }
-
-  if (!RamSize::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "RamSize");
-    return -1;
-  }
-
-  if (!CacheCtrl::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "CacheCtrl");
-    return -1;
-  }
-
-  if (!RAM::range.offset(index, addr)) {
-    memory::store8(ram.data, index, val);
-    return 0;
-  }
+  addr = bus::mask_addr_to_region(addr);
 
-  if (!SPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] Ignored %s", fn, addr,
-              index, val, "IRQ");
-    return -1;
+  if (fastmem.readable(addr)) {
+    ins.data = memory::load32(fastmem.base, addr);
+    clock.tick(hw_regs.cost<u32>(fastmem.page_type(addr)));
+    return;
   }
 
-  if (!Expansion1::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Expansion1");
-    return -1;
-  }
-
-  if (!Expansion2::range.offset(index, addr)) {
-    return ignore_store(val, fn, addr, index, "Expansion2");
-  }
-
-  if (!IRQ::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "IRQ");
-    return -1;
-  }
-
-  if (!Timers::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "Timers");
-    return -1;
-  }
-  
-  if (!DMA::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "DMA");
-    return -1;
-  }
-
-  if (!GPU::range.offset(index, addr)) {
-    LOG_ERROR("[FN:%s ADDR:0x%08x IND:%d VAL:0x%08x] %s", fn, addr, index, val,
-              "GPU");
-    return -1;
-  }
-
-  LOG_ERROR("[FN:%s ADDR:0x%08x VAL:0x%08x] Unhandled", fn, addr, val);
-  return -1;
-}
-
-int PCI::load_instruction(Instruction &ins, u32 addr) {
-  static const char *fn = "PCI::load_instruction";
-  u32 index;
-
-  addr = mask_addr_to_region(addr);
-
   if (!Bios::range.offset(index, addr)) {
     ins.data = memory::load32(bios.data, index);
-    return 0;
+    clock.tick(hw_regs.cost<u32>(PCIType::bios));
+    return;
   }
 
   if (!RAM::range.offset(index, addr)) {
+    index &= RAM::size - 1;
     ins.data = memory::load32(ram.data, index);
-    return 0;
+    return;
   }
 
-  LOG_ERROR("[FN:%s ADDR:0x%08x] Unhandled", fn, addr);
-  return -1;
+  unhandled_instruction(*this, ins, addr);
 }
@@ -162,7 +162,8 @@ int Renderer::create_window_and_context() {
     return -1;
   }
 
-  SDL_GL_SetSwapInterval(1);
+  // NOTE: no vsync, FramePacer keeps the emulated refresh rate
+  SDL_GL_SetSwapInterval(0);
 
   glClearColor(0, 0, 0, 1);
   glClear(GL_COLOR_BUFFER_BIT);
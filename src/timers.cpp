@@ -0,0 +1,333 @@
+#include "timers.hpp"
+#include "log.hpp"
+
+namespace {
+
+using Mode = RootCounter::Mode;
+
+constexpr u32 overflow_wrap = 0x10000;
+
+constexpr ClockDomain sysclk = {1, 1, 0};
+constexpr ClockDomain sysclk_div8 = ClockDomain::from_hz(ClockRate::cpu, 8);
+
+// NOTE: the GPU domains are only recomputed when the video mode changes, see
+// GPU::update_timings
+const ClockDomain &source_domain(const Timers &timers, u32 n) {
+  u32 source = timers.counters[n].clock_source();
+
+  switch (n) {
+  case 0:
+    // NOTE: 0 and 2 are the system clock, 1 and 3 the dot clock
+    if ((source & 1) != 0)
+      return timers.gpu.dot_clock;
+    return sysclk;
+  case 1:
+    // NOTE: 0 and 2 are the system clock, 1 and 3 hblank
+    if ((source & 1) != 0)
+      return timers.gpu.hblank;
+    return sysclk;
+  default:
+    // NOTE: 0 and 1 are the system clock, 2 and 3 system clock / 8
+    if ((source & 2) != 0)
+      return sysclk_div8;
+    return sysclk;
+  }
+}
+
+/// Counter value that wraps to 0 next, counting from cur
+constexpr u32 wrap_point(const RootCounter &c, u32 cur) {
+  // NOTE: a counter already past its target only resets after overflowing
+  if ((c.mode & Mode::reset_on_target) != 0 && cur <= c.target)
+    return c.target + 1;
+  return overflow_wrap;
+}
+
+/// Counter ticks until the next target or overflow IRQ, 0 if there is none
+u64 ticks_to_irq(const RootCounter &c) {
+  if (c.paused)
+    return 0;
+
+  if ((c.mode & Mode::irq_repeat) == 0 && c.irq_fired)
+    return 0;
+
+  u32 cur = c.counter;
+  u32 wrap = wrap_point(c, cur);
+  u64 ticks = 0;
+
+  if ((c.mode & Mode::irq_on_target) != 0) {
+    ticks = cur < c.target ? c.target - cur : (wrap - cur) + c.target;
+  }
+
+  if ((c.mode & Mode::irq_on_overflow) != 0 && wrap == overflow_wrap) {
+    u64 overflow = cur < 0xffff ? 0xffff - cur : overflow_wrap;
+    if (ticks == 0 || overflow < ticks) {
+      ticks = overflow;
+    }
+  }
+
+  return ticks;
+}
+
+} // namespace
+
+void Timers::sync_counter(u32 n, u64 cycles) {
+  RootCounter &c = counters[n];
+
+  // NOTE: the dot clock follows the horizontal resolution, only replace the
+  // domain when it changed so the carried remainder survives
+  const ClockDomain &source = source_domain(*this, n);
+  if (source.num != c.source.num || source.den != c.source.den) {
+    c.source = source;
+  }
+
+  if (c.paused)
+    return;
+
+  u64 ticks = c.source.advance(cycles);
+  if (ticks == 0)
+    return;
+
+  u32 cur = c.counter;
+  u32 wrap = wrap_point(c, cur);
+  bool hit_target = false;
+  bool hit_overflow = false;
+
+  if (cur + ticks < wrap) {
+    hit_target = cur < c.target && cur + ticks >= c.target;
+    hit_overflow = cur + ticks == 0xffff;
+    cur += ticks;
+  } else {
+    // NOTE: runs up to the first wrap, then loops over whole periods
+    hit_target = cur < c.target;
+    hit_overflow = wrap == overflow_wrap;
+    ticks -= wrap - cur;
+
+    u32 period = (c.mode & Mode::reset_on_target) != 0 ? c.target + 1
+                                                         : overflow_wrap;
+    if (ticks >= period) {
+      hit_target = true;
+      hit_overflow |= period == overflow_wrap;
+    }
+
+    cur = ticks % period;
+    hit_target |= cur >= c.target;
+    hit_overflow |= cur == 0xffff;
+  }
+
+  c.counter = cur;
+
+  if (hit_target) {
+    c.mode |= Mode::reached_target;
+    if ((c.mode & Mode::irq_on_target) != 0) {
+      raise_irq(n);
+    }
+  }
+
+  if (hit_overflow) {
+    c.mode |= Mode::reached_overflow;
+    if ((c.mode & Mode::irq_on_overflow) != 0) {
+      raise_irq(n);
+    }
+  }
+}
+
+void Timers::raise_irq(u32 n) {
+  RootCounter &c = counters[n];
+
+  if ((c.mode & Mode::irq_repeat) == 0 && c.irq_fired)
+    return;
+
+  c.irq_fired = true;
+
+  // NOTE: a pulse only drops the request bit for a few cycles, leave it set
+  if ((c.mode & Mode::irq_toggle) != 0) {
+    c.mode ^= Mode::irq_request;
+    if ((c.mode & Mode::irq_request) != 0)
+      return;
+  }
+
+  irq.raise(static_cast<Interrupt>(static_cast<u32>(Interrupt::timer0) + n));
+}
+
+void Timers::set_mode(u32 n, u16 val) {
+  RootCounter &c = counters[n];
+
+  c.mode = (val & Mode::writable) | Mode::irq_request;
+  c.counter = 0;
+  c.irq_fired = false;
+  c.paused = false;
+
+  if ((c.mode & Mode::sync_enable) == 0)
+    return;
+
+  u32 sync_mode = c.sync_mode();
+
+  if (n == 2) {
+    // NOTE: modes 0 and 3 stop the counter, 1 and 2 let it run freely
+    c.paused = sync_mode == 0 || sync_mode == 3;
+    return;
+  }
+
+  // NOTE: counter 0 follows hblank and counter 1 vblank
+  c.blanking = n == 0 ? gpu.in_hblank() : gpu.in_vblank();
+
+  switch (sync_mode) {
+  case 0:
+    // NOTE: paused during blank
+    c.paused = c.blanking;
+    break;
+  case 1:
+    // NOTE: reset at blank
+    break;
+  case 2:
+    // NOTE: reset at blank, paused outside of it
+    c.paused = !c.blanking;
+    break;
+  case 3:
+    // NOTE: paused until the next blank, then free run
+    c.paused = true;
+    break;
+  }
+}
+
+void Timers::set_blanking(u32 n, bool blanking) {
+  RootCounter &c = counters[n];
+  bool started = blanking && !c.blanking;
+
+  c.blanking = blanking;
+
+  if ((c.mode & Mode::sync_enable) == 0)
+    return;
+
+  switch (c.sync_mode()) {
+  case 0:
+    c.paused = blanking;
+    break;
+  case 1:
+    if (started) {
+      c.counter = 0;
+    }
+    break;
+  case 2:
+    if (started) {
+      c.counter = 0;
+    }
+    c.paused = !blanking;
+    break;
+  case 3:
+    if (started) {
+      c.paused = false;
+      c.mode &= ~Mode::sync_enable;
+    }
+    break;
+  }
+}
+
+void Timers::blank(bool hblank, bool vblank, Clock &clock) {
+  bool changed[2] = {hblank != counters[0].blanking,
+                     vblank != counters[1].blanking};
+  bool synced[2] = {(counters[0].mode & Mode::sync_enable) != 0,
+                    (counters[1].mode & Mode::sync_enable) != 0};
+
+  // NOTE: free running counters only need to remember the state
+  if (!(changed[0] && synced[0]) && !(changed[1] && synced[1])) {
+    counters[0].blanking = hblank;
+    counters[1].blanking = vblank;
+    return;
+  }
+
+  clock.sync(PCIType::timers);
+  set_blanking(0, hblank);
+  set_blanking(1, vblank);
+
+  // NOTE: pausing or resetting moves the next IRQ
+  clock.sync(PCIType::timers);
+}
+
+u64 Timers::next_irq_delay() const {
+  u64 delta = Clock::never;
+
+  for (u32 n = 0; n < count; ++n) {
+    u64 ticks = ticks_to_irq(counters[n]);
+    if (ticks == 0)
+      continue;
+
+    u64 cycles = counters[n].source.cpu_cycles_until(ticks);
+    if (cycles < delta) {
+      delta = cycles;
+    }
+  }
+
+  return delta;
+}
+
+u64 Timers::sync(u64 cycles, Clock &) {
+  for (u32 n = 0; n < count; ++n) {
+    sync_counter(n, cycles);
+  }
+
+  return next_irq_delay();
+}
+
+int Timers::load(u32 &val, u32 index, Clock &clock) {
+  u32 n = index >> Reg::counter_shift;
+  RootCounter &c = counters[n];
+
+  clock.sync(PCIType::timers);
+
+  switch (index & 0xf) {
+  case Reg::current:
+    val = c.counter;
+    return 0;
+  case Reg::mode:
+    val = c.mode;
+    c.mode &= ~(Mode::reached_target | Mode::reached_overflow);
+    return 0;
+  case Reg::target:
+    val = c.target;
+    return 0;
+  }
+
+  LOG_ERROR("[FN:Timers::load IDX:0x%02x] Unhandled", index);
+  return -1;
+}
+
+int Timers::store(u32 val, u32 index, Clock &clock) {
+  u32 n = index >> Reg::counter_shift;
+  RootCounter &c = counters[n];
+
+  clock.sync(PCIType::timers);
+
+  switch (index & 0xf) {
+  case Reg::current:
+    c.counter = val;
+    break;
+  case Reg::mode:
+    // NOTE: the sync modes of counters 0 and 1 start from the current
+    // blanking state
+    if (n < 2) {
+      clock.sync(PCIType::gpu);
+    }
+
+    set_mode(n, val);
+    // NOTE: the source may have changed, start counting with it right away
+    sync_counter(n, 0);
+
+    // NOTE: the GPU only reports hblank edges while timer 0 needs them
+    if (n == 0) {
+      clock.sync(PCIType::gpu);
+    }
+    break;
+  case Reg::target:
+    c.target = val;
+    break;
+  default:
+    LOG_ERROR("[FN:Timers::store IDX:0x%02x VAL:0x%08x] Unhandled", index,
+              val);
+    return -1;
+  }
+
+  // NOTE: the next IRQ may have moved
+  clock.sync(PCIType::timers);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include "watchpoint.hpp"
+#include "log.hpp"
+
+int Watchpoints::add(u32 addr, u32 len, u8 kinds) {
+  if (count == capacity) {
+    LOG_ERROR("No room for watchpoint at 0x%08x", addr);
+    return -1;
+  }
+
+  if (len == 0 || kinds == 0) {
+    LOG_ERROR("Empty watchpoint at 0x%08x", addr);
+    return -1;
+  }
+
+  list[count++] = {addr, len, kinds};
+  return 0;
+}
+
+int Watchpoints::remove(u32 addr) {
+  for (u32 i = 0; i < count; ++i) {
+    if (list[i].addr == addr) {
+      list[i] = list[--count];
+      return 0;
+    }
+  }
+
+  LOG_ERROR("No watchpoint at 0x%08x", addr);
+  return -1;
+}
+
+u8 Watchpoints::kinds_in_page(u32 addr, u32 page_shift) const {
+  u32 page = addr >> page_shift;
+  u8 kinds = 0;
+
+  for (u32 i = 0; i < count; ++i) {
+    const Watchpoint &wp = list[i];
+    u32 first = wp.addr >> page_shift;
+    u32 last = (wp.addr + wp.len - 1) >> page_shift;
+
+    if (page >= first && page <= last) {
+      kinds |= wp.kinds;
+    }
+  }
+
+  return kinds;
+}
+
+void Watchpoints::check(u8 kind, u32 addr, u32 width, u32 val, u64 cycle) {
+  u32 bytes = width / 8;
+
+  for (u32 i = 0; i < count; ++i) {
+    const Watchpoint &wp = list[i];
+
+    if ((wp.kinds & kind) == 0 || addr + bytes <= wp.addr ||
+        addr >= wp.addr + wp.len)
+      continue;
+
+    WatchHit hit = {
+        .pc = pc != nullptr ? *pc : 0,
+        .addr = addr,
+        .width = width,
+        .val = val,
+        .cycle = cycle,
+        .kind = kind,
+    };
+
+    hits[hit_count++ % capacity] = hit;
+
+    LOG_INFO("[PC:0x%08x ADDR:0x%08x W:%d VAL:0x%08x CYCLE:%lu] Watchpoint %s",
+             hit.pc, addr, width, val, cycle,
+             kind == Watchpoint::Kind::read ? "read" : "write");
+    return;
+  }
+}